@@ -1,10 +1,17 @@
 precision mediump float;
 
-uniform sampler2D Texture;
+// the pages of the draw call
+uniform sampler2D Texture[4];
 
 varying vec2 _texcoord;
+varying float _page;
 
 void main()
 {
-    gl_FragColor = texture2D(Texture, _texcoord);
+    // samplers take constant indices only; the page is the same over each
+    // triangle, so the branch is too
+    if (_page < 0.5) { gl_FragColor = texture2D(Texture[0], _texcoord); }
+    else if (_page < 1.5) { gl_FragColor = texture2D(Texture[1], _texcoord); }
+    else if (_page < 2.5) { gl_FragColor = texture2D(Texture[2], _texcoord); }
+    else { gl_FragColor = texture2D(Texture[3], _texcoord); }
 }
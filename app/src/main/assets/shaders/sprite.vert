@@ -1,12 +1,19 @@
 uniform mat3 Matrix;
+uniform float LayerDepth;
 
-attribute vec2 y;
+attribute vec2 transform;
 attribute vec2 texcoord;
+attribute float page;
+attribute float layer;
 
 varying vec2 _texcoord;
+varying float _page;
 
 void main()
 {
-    _texcoord = texcoord;
-    gl_Position = vec4((Matrix * vec3(y.xy, 1)).xy, 0, 1);
+    // batch vertices store texture coordinates in steps of 1/8192
+    _texcoord = texcoord * (1.0 / 8192.0);
+    _page = page;
+    // later sprites are nearer, LayerDepth apart
+    gl_Position = vec4((Matrix * vec3(transform.xy, 1)).xy, 1.0 - (layer + 1.0) * LayerDepth, 1);
 }
@@ -0,0 +1,175 @@
+#include "../code/affine.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace legacy {
+
+    // the 3x3 matrix code affine.h replaced, kept as the baseline
+    struct mat3 { float m[9]; };
+
+    inline mat3 mat3_translation(float tx, float ty)
+    {
+        return mat3 { { 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, tx, ty, 1.0f } };
+    }
+
+    inline mat3 mat3_scaling(float sx, float sy)
+    {
+        return mat3 { { sx, 0.0f, 0.0f, 0.0f, sy, 0.0f, 0.0f, 0.0f, 1.0f } };
+    }
+
+    inline mat3 mat3_rotation(float angle)
+    {
+        const float rad = static_cast<float>(M_PI * angle / 180.0f);
+        const float cosa = cosf(rad);
+        const float sina = sinf(rad);
+        return mat3 { { cosa, -sina, 0.0f, sina, cosa, 0.0f, 0.0f, 0.0f, 1.0f } };
+    }
+
+    inline mat3 operator*(mat3 m1, mat3 m2)
+    {
+        return mat3 { {
+            m1.m[0] * m2.m[0] + m1.m[1] * m2.m[3],
+            m1.m[0] * m2.m[1] + m1.m[1] * m2.m[4],
+            0.0f,
+            m1.m[3] * m2.m[0] + m1.m[4] * m2.m[3],
+            m1.m[3] * m2.m[1] + m1.m[4] * m2.m[4],
+            0.0f,
+            m1.m[6] * m2.m[0] + m1.m[7] * m2.m[3] + m2.m[6],
+            m1.m[6] * m2.m[1] + m1.m[7] * m2.m[4] + m2.m[7],
+            1.0f
+        } };
+    }
+
+    inline vec2 operator*(mat3 m, vec2 v)
+    {
+        return vec2 { m.m[0] * v.x + m.m[3] * v.y + m.m[6], m.m[1] * v.x + m.m[4] * v.y + m.m[7] };
+    }
+
+}
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+
+    volatile float sink;
+
+    template<class F>
+    void run(const char* name, size_t iterations, F f)
+    {
+        f(); // warm-up
+
+        const auto start = clock_type::now();
+        for (size_t i = 0; i < iterations; ++i) { f(); }
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start).count();
+
+        std::printf("%-32s %10zu iterations %10.2f ns/op\n", name, iterations, double(ns) / iterations);
+    }
+
+    float max_error(const legacy::mat3& l, const affine& a)
+    {
+        const float diff[] = {
+            l.m[0] - a.m[0], l.m[1] - a.m[1], l.m[3] - a.m[2],
+            l.m[4] - a.m[3], l.m[6] - a.m[4], l.m[7] - a.m[5]
+        };
+
+        float e = 0.0f;
+        for (float d: diff) { e = std::fmax(e, std::fabs(d)); }
+        return e;
+    }
+
+}
+
+int main()
+{
+    const size_t ITERATIONS = 1000000;
+    const size_t NUM_POINTS = 1024;
+
+    const float rot[] = { 0.0f, -1.0f, 0.0f, 1.0f, -1.0f, 1.0f };
+
+    float error = 0.0f;
+    for (size_t i = 0; i < 6; ++i)
+    {
+        const auto l = legacy::mat3_scaling(3.0f, 1.0f) * legacy::mat3_rotation(rot[i] * 90.0f) *
+            legacy::mat3_translation(10.0f, -80.0f);
+        const auto a = affine_scaling(3.0f, 1.0f) * affine_rotation(rot[i] * 90.0f) *
+            affine_translation(10.0f, -80.0f);
+        error = std::fmax(error, max_error(l, a));
+    }
+    std::printf("stroke matrix max error vs mat3: %g\n", error);
+
+    size_t n = 0;
+
+    run("mat3 stroke compose", ITERATIONS, [&]
+    {
+        const auto m = legacy::mat3_scaling(1.0f + n, 1.0f) *
+            legacy::mat3_rotation(rot[n % 6] * 90.0f) * legacy::mat3_translation(10.0f, -80.0f);
+        ++n;
+        sink = m.m[6];
+    });
+
+    run("affine stroke compose", ITERATIONS, [&]
+    {
+        const auto m = affine_scaling(1.0f + n, 1.0f) *
+            affine_rotation(rot[n % 6] * 90.0f) * affine_translation(10.0f, -80.0f);
+        ++n;
+        sink = m.m[4];
+    });
+
+    const vec2 corners[] = { { -8.0f, -6.0f }, { -8.0f, 6.0f }, { 7.0f, -6.0f }, { 7.0f, 6.0f } };
+
+    run("mat3 quad transform", ITERATIONS, [&]
+    {
+        const auto m = legacy::mat3_translation(float(n++), 4.0f);
+        vec2 out[4];
+        for (size_t i = 0; i < 4; ++i) { out[i] = m * corners[i]; }
+        sink = out[3].x;
+    });
+
+    run("affine quad transform", ITERATIONS, [&]
+    {
+        const auto m = affine_translation(float(n++), 4.0f);
+        vec2 out[4];
+        affine_transform_points(m, corners, out, 4);
+        sink = out[3].x;
+    });
+
+    std::vector<vec2> points(NUM_POINTS, vec2 { 1.0f, 2.0f });
+    std::vector<vec2> transformed(NUM_POINTS);
+
+    run("mat3 transform 1024 points", ITERATIONS / 100, [&]
+    {
+        const auto m = legacy::mat3_rotation(30.0f) * legacy::mat3_translation(float(n++), 4.0f);
+        for (size_t i = 0; i < NUM_POINTS; ++i) { transformed[i] = m * points[i]; }
+        sink = transformed.back().x;
+    });
+
+    run("affine transform 1024 points", ITERATIONS / 100, [&]
+    {
+        const auto m = affine_rotation(30.0f) * affine_translation(float(n++), 4.0f);
+        affine_transform_points(m, points.data(), transformed.data(), NUM_POINTS);
+        sink = transformed.back().x;
+    });
+
+    std::vector<legacy::mat3> legacy_matrices(NUM_POINTS, legacy::mat3_rotation(30.0f));
+    std::vector<legacy::mat3> legacy_composed(NUM_POINTS);
+    std::vector<affine> matrices(NUM_POINTS, affine_rotation(30.0f));
+    std::vector<affine> composed(NUM_POINTS);
+
+    run("mat3 compose 1024 matrices", ITERATIONS / 100, [&]
+    {
+        const auto t = legacy::mat3_translation(float(n++), 0.0f);
+        for (size_t i = 0; i < NUM_POINTS; ++i) { legacy_composed[i] = legacy_matrices[i] * t; }
+        sink = legacy_composed.back().m[6];
+    });
+
+    run("affine compose 1024 matrices", ITERATIONS / 100, [&]
+    {
+        affine_compose_batch(matrices.data(), affine_translation(float(n++), 0.0f), composed.data(), NUM_POINTS);
+        sink = composed.back().m[4];
+    });
+
+    return 0;
+}
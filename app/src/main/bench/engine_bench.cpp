@@ -0,0 +1,309 @@
+// Benchmarks of the engine hot paths on the host, built against the headless
+// renderer. Iteration counts are fixed so runs are comparable between commits.
+// Prints one CSV row per benchmark: name,iterations,ns_per_op.
+//
+// usage: engine_bench <assets-dir>
+
+#include "../code/affine.h"
+#include "../code/animation.h"
+#include "../code/bmp.h"
+#include "../code/bundle.h"
+#include "../code/font.h"
+#include "../code/pixel_format.h"
+#include "../code/renderer.h"
+#include "../code/simulation.h"
+#include "../code/string_table.h"
+#include "../code/text_label.h"
+#include "../code/world.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+
+    const int64_t DELTA_TIME = 1000 / 60;
+
+    volatile float sink;
+
+    template<class F>
+    void run(const char* name, size_t iterations, F f)
+    {
+        f(); // warm-up
+
+        const auto start = clock_type::now();
+        for (size_t i = 0; i < iterations; ++i) { f(); }
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start).count();
+
+        std::printf("%s,%zu,%.2f\n", name, iterations, double(ns) / iterations);
+    }
+
+    std::vector<uint8_t> read_file(const std::string& path)
+    {
+        std::ifstream s { path, std::ios::binary };
+        if (!s.is_open()) { throw std::runtime_error("can not open " + path); }
+        return std::vector<uint8_t> { std::istreambuf_iterator<char>(s), std::istreambuf_iterator<char>() };
+    }
+
+    // generated content: many sprites on one page, an array over every tenth
+    std::string synthetic_bundle(size_t sprites)
+    {
+        std::string text =
+            "texture page-0 textures/page-0.bmp 1024 1024\n"
+            "shader sprite shaders/sprite.vert shaders/sprite.frag\n"
+            "material generated blend-alpha sprite page-0\n";
+
+        std::string array = "sprite-array generated";
+        uint32_t random = 1;
+
+        for (size_t i = 0; i < sprites; ++i)
+        {
+            const std::string id = "generated-sprite-" + std::to_string(i);
+            const uint32_t x = next_random(random) % 900;
+            const uint32_t y = next_random(random) % 900;
+
+            text += "sprite " + id + " generated " +
+                std::to_string(x) + " " + std::to_string(x + 1 + next_random(random) % 120) + " " +
+                std::to_string(y) + " " + std::to_string(y + 1 + next_random(random) % 120) + " " +
+                std::to_string((next_random(random) % 1600) * 0.01f) + " " +
+                std::to_string((next_random(random) % 1600) * 0.01f) + "\n";
+
+            if (i % 10 == 0) { array += " " + id; }
+        }
+
+        return text + array + "\n";
+    }
+
+    // advances the world in one phase, restarting from `start` when it leaves it
+    void run_phase(const char* name, world& w, const simulation_state& start, size_t tap_every)
+    {
+        w.restore(start);
+        const game_phase phase = start.game.phase;
+        size_t tick = 0;
+
+        run(name, 100000, [&]
+        {
+            if (tap_every != 0 && ++tick % tap_every == 0) { w.handle_tap(); }
+            w.integrate(DELTA_TIME);
+            if (w.state().phase != phase) { w.restore(start); }
+        });
+    }
+
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2)
+    {
+        std::fprintf(stderr, "usage: engine_bench <assets-dir>\n");
+        return 1;
+    }
+
+    try
+    {
+        const std::string root = std::string(argv[1]) + "/";
+        const std::vector<uint8_t> bundle_bytes = read_file(root + "bundle.txt");
+        const std::string bundle_text { bundle_bytes.begin(), bundle_bytes.end() };
+
+        std::printf("name,iterations,ns_per_op\n");
+
+        run("bundle_parse", 2000, [&]
+        {
+            bundle b;
+            parse_bundle(bundle_text, b);
+            sink = float(b.textures().size());
+        });
+
+        const std::string synthetic_text = synthetic_bundle(100000);
+
+        run("bundle_parse_100k_sprites", 5, [&]
+        {
+            bundle b;
+            parse_bundle(synthetic_text, b);
+            sink = float(b.textures().size());
+        });
+
+        bundle b;
+        parse_bundle(bundle_text, b);
+
+        run("bundle_sprite_lookup", 1000000, [&]
+        {
+            sink = b.sprite("background").rect.right;
+        });
+
+        run("bundle_value_lookup", 1000000, [&]
+        {
+            sink = b.value("jump-velocity");
+        });
+
+        const string_key jump_velocity { "jump-velocity" };
+
+        run("bundle_value_lookup_prehashed", 1000000, [&]
+        {
+            sink = b.value(jump_velocity);
+        });
+
+        // the flat table against the node-based map it replaced, over 100k names
+        std::vector<std::string> names;
+        string_table<size_t> flat;
+        std::unordered_map<std::string, size_t> nodes;
+
+        for (size_t i = 0; i < 100000; ++i)
+        {
+            names.push_back("generated-sprite-" + std::to_string(i));
+            flat.emplace(names.back(), i);
+            nodes.emplace(names.back(), i);
+        }
+
+        size_t name = 0;
+
+        run("string_table_find_100k", 1000000, [&]
+        {
+            sink = float(*flat.find(names[name++ % names.size()]));
+        });
+
+        run("unordered_map_find_100k", 1000000, [&]
+        {
+            sink = float(nodes.find(names[name++ % names.size()])->second);
+        });
+
+        run("string_table_find_literal", 1000000, [&]
+        {
+            sink = float(*flat.find("generated-sprite-4242"));
+        });
+
+        run("unordered_map_find_literal", 1000000, [&]
+        {
+            sink = float(nodes.find("generated-sprite-4242")->second);
+        });
+
+        const std::vector<uint8_t> bmp = read_file(root + b.textures().front().path);
+        std::vector<uint8_t> texels;
+        uint32_t width, height;
+
+        run("bmp_decode", 200, [&]
+        {
+            decode_bmp(bmp, width, height, texels);
+            sink = texels.back();
+        });
+
+        std::vector<uint8_t> packed;
+
+        run("pack_texels_rgb565_dither", 200, [&]
+        {
+            packed = texels;
+            pack_texels(packed, width, height, pixel_format::rgb565, true);
+            sink = packed.back();
+        });
+
+        size_t n = 0;
+        const float rot[] = { 0.0f, -1.0f, 0.0f, 1.0f, -1.0f, 1.0f };
+
+        run("affine_stroke_compose", 1000000, [&]
+        {
+            const auto m = affine_scaling(1.0f + n, 1.0f) *
+                affine_rotation(rot[n % 6] * 90.0f) * affine_translation(10.0f, -80.0f);
+            ++n;
+            sink = m.m[4];
+        });
+
+        const vec2 corners[] = { { -8.0f, -6.0f }, { -8.0f, 6.0f }, { 7.0f, -6.0f }, { 7.0f, 6.0f } };
+
+        run("affine_quad_transform", 1000000, [&]
+        {
+            const auto m = affine_translation(float(n++), 4.0f);
+            vec2 out[4];
+            affine_transform_points(m, corners, out, 4);
+            sink = out[3].x;
+        });
+
+        renderer r(nullptr);
+        const sprite background = b.sprite("background");
+        const affine rotated = affine_rotation(30.0f) * affine_translation(10.0f, 4.0f);
+
+        // one frame of 512 sprites, vertex generation and batching
+        run("renderer_draw_512", 10000, [&]
+        {
+            r.begin_frame(0.5f, DELTA_TIME);
+            for (size_t i = 0; i < 512; ++i) { r.draw(background, rotated); }
+            r.end_frame();
+        });
+
+        // the same frame submitted in bulk, with matrices and with positions
+        const std::vector<const sprite*> many(512, &background);
+        const std::vector<affine> many_matrices(512, rotated);
+        const std::vector<vec2> many_positions(512, vec2 { 10.0f, 4.0f });
+
+        run("renderer_draw_many_affine_512", 10000, [&]
+        {
+            r.begin_frame(0.5f, DELTA_TIME);
+            r.draw(many.data(), many_matrices.data(), many.size());
+            r.end_frame();
+        });
+
+        run("renderer_draw_many_positions_512", 10000, [&]
+        {
+            r.begin_frame(0.5f, DELTA_TIME);
+            r.draw(many.data(), many_positions.data(), many.size());
+            r.end_frame();
+        });
+
+        animation_system animations(b);
+        world w(0, b, animations);
+
+        const simulation_state begin = w.snapshot();
+        w.handle_tap();
+        const simulation_state play = w.snapshot();
+        while (w.state().phase != game_phase::end) { w.integrate(DELTA_TIME); }
+        const simulation_state end = w.snapshot();
+
+        run_phase("world_integrate_begin", w, begin, 0);
+        run_phase("world_integrate_play", w, play, 36);
+        run_phase("world_integrate_end", w, end, 0);
+
+        const simulation& rules = w.rules();
+        simulation_state moving = play;
+        rules.integrate(moving, DELTA_TIME);
+
+        run("simulation_find_impact", 1000000, [&]
+        {
+            float toi;
+            sink = rules.find_impact(moving, toi) ? toi : 2.0f;
+        });
+
+        // restore rebuilds every span view through update_span_view
+        run("world_restore_span_views", 100000, [&]
+        {
+            w.restore(play);
+        });
+
+        const font points_font(b.font("points-font"));
+        text_label label(points_font);
+        label.set_align(0.5f);
+        uint32_t score = 0;
+
+        run("text_label_set_number", 1000000, [&]
+        {
+            label.set_number(score++ % 1000);
+        });
+
+        run("text_label_draw", 1000000, [&]
+        {
+            r.begin_frame(0.5f, DELTA_TIME);
+            label.draw(&r);
+            r.end_frame();
+        });
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "engine_bench: %s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
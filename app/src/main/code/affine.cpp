@@ -0,0 +1,132 @@
+#include "affine.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define AFFINE_NEON 1
+#include <arm_neon.h>
+#elif defined(__SSE__) || defined(_M_X64)
+#define AFFINE_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace {
+
+    inline void transform_points_scalar(const affine& m, const vec2* in, vec2* out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) { out[i] = m * in[i]; }
+    }
+
+    inline void compose_scalar(const affine* in, const affine& m, affine* out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) { out[i] = in[i] * m; }
+    }
+
+}
+
+#if defined(AFFINE_NEON)
+
+void affine_transform_point_array(const affine& m, const vec2* in, vec2* out, size_t count)
+{
+    const float32x4_t m0 = vdupq_n_f32(m.m[0]);
+    const float32x4_t m1 = vdupq_n_f32(m.m[1]);
+    const float32x4_t m2 = vdupq_n_f32(m.m[2]);
+    const float32x4_t m3 = vdupq_n_f32(m.m[3]);
+    const float32x4_t m4 = vdupq_n_f32(m.m[4]);
+    const float32x4_t m5 = vdupq_n_f32(m.m[5]);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const float32x4x2_t p = vld2q_f32(&in[i].x);
+        float32x4x2_t r;
+        r.val[0] = vmlaq_f32(vmlaq_f32(m4, m0, p.val[0]), m2, p.val[1]);
+        r.val[1] = vmlaq_f32(vmlaq_f32(m5, m1, p.val[0]), m3, p.val[1]);
+        vst2q_f32(&out[i].x, r);
+    }
+
+    transform_points_scalar(m, in + i, out + i, count - i);
+}
+
+void affine_compose_batch(const affine* in, const affine& m, affine* out, size_t count)
+{
+    const float32x2_t x_axis = vld1_f32(&m.m[0]);
+    const float32x2_t y_axis = vld1_f32(&m.m[2]);
+    const float32x2_t offset = vld1_f32(&m.m[4]);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float* a = in[i].m;
+        const float32x2_t r01 = vmla_n_f32(vmul_n_f32(x_axis, a[0]), y_axis, a[1]);
+        const float32x2_t r23 = vmla_n_f32(vmul_n_f32(x_axis, a[2]), y_axis, a[3]);
+        const float32x2_t r45 = vmla_n_f32(vmla_n_f32(offset, x_axis, a[4]), y_axis, a[5]);
+        vst1_f32(&out[i].m[0], r01);
+        vst1_f32(&out[i].m[2], r23);
+        vst1_f32(&out[i].m[4], r45);
+    }
+}
+
+#elif defined(AFFINE_SSE)
+
+void affine_transform_point_array(const affine& m, const vec2* in, vec2* out, size_t count)
+{
+    const __m128 m0 = _mm_set1_ps(m.m[0]);
+    const __m128 m1 = _mm_set1_ps(m.m[1]);
+    const __m128 m2 = _mm_set1_ps(m.m[2]);
+    const __m128 m3 = _mm_set1_ps(m.m[3]);
+    const __m128 m4 = _mm_set1_ps(m.m[4]);
+    const __m128 m5 = _mm_set1_ps(m.m[5]);
+
+    // four points at a time, split into x and y lanes like vld2q on NEON
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 p01 = _mm_loadu_ps(&in[i].x);
+        const __m128 p23 = _mm_loadu_ps(&in[i + 2].x);
+        const __m128 xs = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 ys = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(3, 1, 3, 1));
+
+        const __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, xs), _mm_mul_ps(m2, ys)), m4);
+        const __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, xs), _mm_mul_ps(m3, ys)), m5);
+
+        _mm_storeu_ps(&out[i].x, _mm_unpacklo_ps(rx, ry));
+        _mm_storeu_ps(&out[i + 2].x, _mm_unpackhi_ps(rx, ry));
+    }
+
+    transform_points_scalar(m, in + i, out + i, count - i);
+}
+
+void affine_compose_batch(const affine* in, const affine& m, affine* out, size_t count)
+{
+    const __m128 x_axis = _mm_setr_ps(m.m[0], m.m[1], m.m[0], m.m[1]);
+    const __m128 y_axis = _mm_setr_ps(m.m[2], m.m[3], m.m[2], m.m[3]);
+    const __m128 offset = _mm_setr_ps(m.m[4], m.m[5], 0.0f, 0.0f);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float* a = in[i].m;
+        const __m128 lin = _mm_loadu_ps(a);
+        const __m128 tx = _mm_set1_ps(a[4]);
+        const __m128 ty = _mm_set1_ps(a[5]);
+
+        const __m128 xs = _mm_shuffle_ps(lin, lin, _MM_SHUFFLE(2, 2, 0, 0));
+        const __m128 ys = _mm_shuffle_ps(lin, lin, _MM_SHUFFLE(3, 3, 1, 1));
+        const __m128 r = _mm_add_ps(_mm_mul_ps(xs, x_axis), _mm_mul_ps(ys, y_axis));
+        const __m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, x_axis), _mm_mul_ps(ty, y_axis)), offset);
+
+        _mm_storeu_ps(&out[i].m[0], r);
+        _mm_storel_pi(reinterpret_cast<__m64*>(&out[i].m[4]), t);
+    }
+}
+
+#else
+
+void affine_transform_point_array(const affine& m, const vec2* in, vec2* out, size_t count)
+{
+    transform_points_scalar(m, in, out, count);
+}
+
+void affine_compose_batch(const affine* in, const affine& m, affine* out, size_t count)
+{
+    compose_scalar(in, m, out, count);
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef AFFINE_H
+#define AFFINE_H
+
+#include "types.h"
+
+#include <cmath>
+#include <cstddef>
+
+// 2x3 affine transform, columns are x axis, y axis and translation:
+//   x' = m[0] * x + m[2] * y + m[4]
+//   y' = m[1] * x + m[3] * y + m[5]
+// a * b applies a first, then b.
+
+inline constexpr affine affine_identity()
+{
+    return affine { { 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f } };
+}
+
+inline constexpr affine affine_translation(float tx, float ty)
+{
+    return affine { { 1.0f, 0.0f, 0.0f, 1.0f, tx, ty } };
+}
+
+inline constexpr affine affine_scaling(float sx, float sy)
+{
+    return affine { { sx, 0.0f, 0.0f, sy, 0.0f, 0.0f } };
+}
+
+inline affine affine_rotation(float angle)
+{
+    // multiples of 90 degrees are exact and skip the trigonometry
+    const float quarters = angle / 90.0f;
+    if (quarters == std::floor(quarters) && std::fabs(quarters) < 1.0e6f)
+    {
+        static const float cosq[] = { 1.0f, 0.0f, -1.0f, 0.0f };
+        static const float sinq[] = { 0.0f, 1.0f, 0.0f, -1.0f };
+        const int q = ((static_cast<int>(quarters) % 4) + 4) % 4;
+        return affine { { cosq[q], -sinq[q], sinq[q], cosq[q], 0.0f, 0.0f } };
+    }
+
+    const float rad = static_cast<float>(M_PI * angle / 180.0f);
+    const float cosa = cosf(rad);
+    const float sina = sinf(rad);
+    return affine { { cosa, -sina, sina, cosa, 0.0f, 0.0f } };
+}
+
+inline constexpr affine operator*(const affine& a, const affine& b)
+{
+    return affine { {
+        b.m[0] * a.m[0] + b.m[2] * a.m[1],
+        b.m[1] * a.m[0] + b.m[3] * a.m[1],
+        b.m[0] * a.m[2] + b.m[2] * a.m[3],
+        b.m[1] * a.m[2] + b.m[3] * a.m[3],
+        b.m[0] * a.m[4] + b.m[2] * a.m[5] + b.m[4],
+        b.m[1] * a.m[4] + b.m[3] * a.m[5] + b.m[5]
+    } };
+}
+
+inline constexpr vec2 operator*(const affine& m, vec2 v)
+{
+    return vec2 {
+        m.m[0] * v.x + m.m[2] * v.y + m.m[4],
+        m.m[1] * v.x + m.m[3] * v.y + m.m[5]
+    };
+}
+
+// column-major 3x3 layout expected by glUniformMatrix3fv
+inline void affine_to_mat3(const affine& a, float* out)
+{
+    out[0] = a.m[0]; out[1] = a.m[1]; out[2] = 0.0f;
+    out[3] = a.m[2]; out[4] = a.m[3]; out[5] = 0.0f;
+    out[6] = a.m[4]; out[7] = a.m[5]; out[8] = 1.0f;
+}
+
+// the vector kernel behind affine_transform_points
+void affine_transform_point_array(const affine& m, const vec2* in, vec2* out, size_t count);
+
+// out[i] = m * in[i]; in and out may alias. A quad's worth of points costs
+// less than the call, so short arrays stay inline.
+inline void affine_transform_points(const affine& m, const vec2* in, vec2* out, size_t count)
+{
+    if (count > 4)
+    {
+        affine_transform_point_array(m, in, out, count);
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i) { out[i] = m * in[i]; }
+}
+
+// out[i] = in[i] * m; in and out may alias
+void affine_compose_batch(const affine* in, const affine& m, affine* out, size_t count);
+
+#endif
@@ -1,23 +1,72 @@
 #include "animation.h"
 
-animation::animation(std::vector<sprite> frames, float rate)
-    : frames_(frames)
-    , interval_(1000.0f / rate)
+#include "bundle.h"
+
+namespace {
+
+    const uint32_t MILLISECONDS = 1000;
+
+    const uint8_t PLAYING = 1;
+    const uint8_t LOOP = 2;
+
+}
+
+animation_system::animation_system(const bundle& b)
+    : bundle_(b)
 {}
 
-void animation::play(bool loop)
+size_t animation_system::add(size_t clip)
+{
+    states_.emplace_back(state { static_cast<uint32_t>(clip), 0, 0, 0 });
+    return states_.size() - 1;
+}
+
+void animation_system::play(size_t animation, bool loop)
+{
+    state& s = states_[animation];
+    s.frame = 0;
+    s.elapsed = 0;
+    s.flags = PLAYING | (loop ? LOOP : 0);
+}
+
+void animation_system::advance(int64_t delta)
 {
-    time_ = 0;
-    loop_ = loop;
+    const clip_source* clips = bundle_.clips().data();
+    const auto ms = static_cast<uint32_t>(delta);
+
+    for (auto& s: states_)
+    {
+        if ((s.flags & PLAYING) == 0) { continue; }
+
+        const clip_source& clip = clips[s.clip];
+        s.elapsed += ms * clip.rate;
+
+        while (s.elapsed >= MILLISECONDS)
+        {
+            s.elapsed -= MILLISECONDS;
+            if (++s.frame < clip.frame_count) { continue; }
+
+            if ((s.flags & LOOP) != 0)
+            {
+                s.frame = 0;
+            }
+            else
+            {
+                s.frame = static_cast<uint32_t>(clip.frame_count - 1);
+                s.flags &= static_cast<uint8_t>(~PLAYING);
+                break;
+            }
+        }
+    }
 }
 
-bool animation::advance(int64_t delta)
+bool animation_system::is_playing(size_t animation) const
 {
-    time_ += delta;
-    return loop_ || (time_ < interval_ * frames_.size());
+    return (states_[animation].flags & PLAYING) != 0;
 }
 
-const sprite& animation::frame() const
+const sprite& animation_system::frame(size_t animation) const
 {
-    return frames_[static_cast<size_t>(time_ / interval_) % frames_.size()];
+    const state& s = states_[animation];
+    return bundle_.clip_frames()[bundle_.clips()[s.clip].first_frame + s.frame];
 }
@@ -1,25 +1,39 @@
 #ifndef ANIMATION_H
 #define ANIMATION_H
 
-#include "sprite.h"
-
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
-class animation final
+class bundle;
+struct sprite;
+
+// Plays bundle clips. Every animation is a small state record referring to
+// a clip by index; advance() steps all of them in one pass.
+class animation_system final
 {
 public:
-    animation(std::vector<sprite> frames, float rate);
+    explicit animation_system(const bundle& b);
+
+    size_t add(size_t clip);
 
-    void play(bool loop);
-    bool advance(int64_t delta);
-    const sprite& frame() const;
+    void play(size_t animation, bool loop);
+    void advance(int64_t delta);
+
+    bool is_playing(size_t animation) const;
+    const sprite& frame(size_t animation) const;
 
 private:
-    const std::vector<sprite> frames_;
-    const float interval_;
-    int64_t time_;
-    bool loop_;
+    struct state
+    {
+        uint32_t clip;
+        uint32_t frame;
+        uint32_t elapsed; // milliseconds times clip rate, below one frame
+        uint8_t flags;
+    };
+
+    const bundle& bundle_;
+    std::vector<state> states_;
 };
 
 #endif
@@ -14,6 +14,11 @@ namespace {
 
 }
 
+int64_t app_clock::monotonic()
+{
+    return now_monotonic();
+}
+
 app_clock::app_clock()
     : start_(now_monotonic())
     , accumulated_(0)
@@ -25,6 +30,11 @@ int64_t app_clock::now() const
     return is_paused_ ? accumulated_ : now_monotonic() + accumulated_ - start_;
 }
 
+int64_t app_clock::from_monotonic(int64_t time) const
+{
+    return is_paused_ ? accumulated_ : time + accumulated_ - start_;
+}
+
 void app_clock::set_paused(bool v)
 {
     if (v == is_paused_) { return; }
@@ -8,7 +8,12 @@ class app_clock final
 public:
     app_clock();
 
+    // milliseconds of CLOCK_MONOTONIC, unaffected by pausing
+    static int64_t monotonic();
+
     int64_t now() const;
+    // maps a monotonic() timestamp, e.g. of an input event, to now() time
+    int64_t from_monotonic(int64_t time) const;
     void set_paused(bool v);
     inline bool is_paused() const { return is_paused_; }
 
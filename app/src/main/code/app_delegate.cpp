@@ -2,16 +2,78 @@
 #include "asset_loader.h"
 #include "bundle.h"
 #include "game.h"
+#include "persistence.h"
 #include "renderer.h"
+#include "resolution_scaler.h"
+#include "tap_queue.h"
+#include "thermal_monitor.h"
+
+#ifdef HOT_RELOAD
+#include "hot_reload.h"
+#endif
 
 #include <android_native_app_glue.h>
+#include <android/log.h>
 #include <android/window.h>
+#include <jni.h>
 
 #include <algorithm>
-#include <fstream>
-#include <sstream>
+#include <cmath>
+#include <cstring>
+
+const char* LOG_TAG = "flappy-thief";
+const uint32_t TAP_LATENCY_REPORT = 16;
+const float DEFAULT_REFRESH_RATE = 60.0f;
+
+// Display.getRefreshRate() of the activity's default display; NDK display
+// timing (AChoreographer) needs API 24
+float display_refresh_rate(ANativeActivity* activity)
+{
+    JNIEnv* env = nullptr;
+    if (activity->vm->AttachCurrentThread(&env, nullptr) != JNI_OK) { return DEFAULT_REFRESH_RATE; }
+
+    float rate = 0.0f;
+
+    jclass activity_class = env->GetObjectClass(activity->clazz);
+    jmethodID get_window_manager = env->GetMethodID(activity_class, "getWindowManager",
+        "()Landroid/view/WindowManager;");
+    jobject window_manager = get_window_manager != nullptr
+        ? env->CallObjectMethod(activity->clazz, get_window_manager) : nullptr;
+
+    // lookups that fail return null with an exception pending
+    if (!env->ExceptionCheck() && window_manager != nullptr)
+    {
+        jclass window_manager_class = env->GetObjectClass(window_manager);
+        jmethodID get_default_display = env->GetMethodID(window_manager_class, "getDefaultDisplay",
+            "()Landroid/view/Display;");
+        jobject display = get_default_display != nullptr
+            ? env->CallObjectMethod(window_manager, get_default_display) : nullptr;
 
-const int64_t DELTA_TIME = 1000 / 60;
+        if (!env->ExceptionCheck() && display != nullptr)
+        {
+            jclass display_class = env->GetObjectClass(display);
+            jmethodID get_refresh_rate = env->GetMethodID(display_class, "getRefreshRate", "()F");
+            if (get_refresh_rate != nullptr) { rate = env->CallFloatMethod(display, get_refresh_rate); }
+
+            env->DeleteLocalRef(display_class);
+            env->DeleteLocalRef(display);
+        }
+
+        env->DeleteLocalRef(window_manager_class);
+        env->DeleteLocalRef(window_manager);
+    }
+
+    if (env->ExceptionCheck())
+    {
+        env->ExceptionClear();
+        rate = 0.0f;
+    }
+
+    env->DeleteLocalRef(activity_class);
+    activity->vm->DetachCurrentThread();
+
+    return rate > 0.0f ? rate : DEFAULT_REFRESH_RATE;
+}
 
 class app_delegate final
 {
@@ -24,38 +86,61 @@ public:
 private:
     android_app* app_;
     asset_loader loader_;
-    std::string score_path_;
+    persistence persistence_;
+    player_stats stats_;
+    uint32_t runs_seen_ = 0;
     app_clock clock_;
+    tap_queue taps_;
     bundle bundle_;
     std::unique_ptr<game> game_;
     std::unique_ptr<renderer> renderer_;
 
-    void handle_command(int32_t command);
-    int32_t handle_input(AInputEvent* event);
-};
+    // offscreen resolution, lowered when frames run late or the device heats up
+    resolution_scaler scaler_;
+    thermal_monitor thermal_;
 
-void save_value(const std::string& path, uint32_t value)
-{
-    std::ofstream stream { path };
-    stream << value;
-    stream.close();
-}
+    void reset_render_scale();
+    void apply_render_scale();
 
-uint32_t load_value(const std::string& path)
-{
-    std::ifstream stream { path };
-    if (!stream.is_open()) { return 0; }
+    // time from APP_CMD_INIT_WINDOW to the first presented frame that has
+    // every page it draws resident
+    int64_t resume_start_ = 0;
+    const char* resume_path_ = nullptr;
 
-    uint32_t score;
-    stream >> score;
-    return score;
-}
+    // tap-to-present: from the input event to the end of the first frame
+    // that shows its effect, in app_clock time
+    int64_t unpresented_tap_ = -1;
+    struct {
+        uint32_t count;
+        int64_t total;
+        int64_t max;
+    } tap_latency_ {};
+
+    void report_tap_latency();
+
+#ifdef HOT_RELOAD
+    std::string hot_reload_root_;
+    std::unique_ptr<hot_reload> hot_reload_;
+#endif
+
+    void handle_command(int32_t command);
+    int32_t handle_input(AInputEvent* event);
+};
 
 app_delegate::app_delegate(android_app* native_app)
         : app_(native_app)
         , loader_(app_->activity->assetManager)
-        , score_path_(std::string(app_->activity->internalDataPath) + "/points")
+        , persistence_(app_->activity->internalDataPath)
+        , stats_(persistence_.load())
 {
+#ifdef HOT_RELOAD
+    // adb can push here without root access
+    const char* data_path = app_->activity->externalDataPath != nullptr
+        ? app_->activity->externalDataPath : app_->activity->internalDataPath;
+    hot_reload_root_ = std::string(data_path) + "/assets";
+    loader_.set_override_root(hot_reload_root_);
+#endif
+
     ANativeActivity_setWindowFlags(
         app_->activity,
         AWINDOW_FLAG_FULLSCREEN,
@@ -82,9 +167,17 @@ app_delegate::~app_delegate()
 
 void app_delegate::run()
 {
-    std::stringstream { loader_.load_string("bundle.txt") } >> bundle_;
+    const std::string bundle_text = loader_.load_string("bundle.txt");
+    parse_bundle(bundle_text, bundle_);
+
+    game_.reset(new game(stats_.best_score, bundle_));
+
+    // 30 for battery saving; swept collision keeps lower rates exact
+    const int64_t delta_time = 1000 / static_cast<int64_t>(bundle_.value("tick-rate"));
 
-    game_.reset(new game(load_value(score_path_), bundle_));
+#ifdef HOT_RELOAD
+    hot_reload_.reset(new hot_reload(hot_reload_root_, bundle_text));
+#endif
 
     int64_t current_time = clock_.now();
     int64_t game_time = 0;
@@ -105,44 +198,146 @@ void app_delegate::run()
             if (app_->destroyRequested != 0) { return; }
         }
 
+#ifdef HOT_RELOAD
+        hot_reload_->update(bundle_, *game_,
+            renderer_ != nullptr && renderer_->has_window() ? renderer_.get() : nullptr, loader_);
+#endif
+
         if (clock_.is_paused()) { continue; }
 
         int64_t frame_time = std::min<int64_t>(time - current_time, 250);
         current_time = time;
         accumulator += frame_time;
 
-        while (accumulator >= DELTA_TIME)
+        // clock time of simulation time zero, moves only when frame_time is clamped
+        const int64_t game_origin = current_time - accumulator - game_time;
+
+        while (accumulator >= delta_time)
+        {
+            // taps land on the tick that covers their timestamp
+            int64_t tap_time;
+            while (taps_.pop_before(game_origin + game_time + delta_time, tap_time))
+            {
+                game_->handle_tap_down();
+                if (unpresented_tap_ < 0) { unpresented_tap_ = tap_time; }
+            }
+
+            game_->integrate(delta_time);
+            game_time += delta_time;
+            accumulator -= delta_time;
+        }
+
+        const game_state& state = game_->state();
+        if (state.runs != runs_seen_)
         {
-            game_->integrate(DELTA_TIME);
-            game_time += DELTA_TIME;
-            accumulator -= DELTA_TIME;
+            runs_seen_ = state.runs;
+            stats_.record_run(state.score);
+            persistence_.save(stats_);
         }
 
-        if (renderer_ != nullptr)
+        if (renderer_ != nullptr && renderer_->has_window())
         {
-            renderer_->begin_frame(accumulator / float(DELTA_TIME), frame_time);
+            if (scaler_.update(frame_time, thermal_.headroom(app_clock::monotonic()))) { apply_render_scale(); }
+
+            renderer_->begin_frame(accumulator / float(delta_time), frame_time);
             game_->draw(renderer_.get());
             renderer_->end_frame();
+
+            if (unpresented_tap_ >= 0) { report_tap_latency(); }
+
+            // pages load in the background, frames before that show the placeholder
+            if (resume_path_ != nullptr && renderer_->residency().pending == 0)
+            {
+                __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "first textured frame after %s start in %lld ms",
+                    resume_path_, static_cast<long long>(app_clock::monotonic() - resume_start_));
+                resume_path_ = nullptr;
+            }
         }
     }
 }
 
+void app_delegate::report_tap_latency()
+{
+    const int64_t latency = clock_.now() - unpresented_tap_;
+    unpresented_tap_ = -1;
+
+    ++tap_latency_.count;
+    tap_latency_.total += latency;
+    tap_latency_.max = std::max(tap_latency_.max, latency);
+
+    if (tap_latency_.count == TAP_LATENCY_REPORT)
+    {
+        __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "tap-to-present %.1f ms average, %lld ms max",
+            double(tap_latency_.total) / tap_latency_.count, static_cast<long long>(tap_latency_.max));
+        tap_latency_ = {};
+    }
+}
+
+// scales are in pixels per screen-width unit and never exceed the window's
+void app_delegate::reset_render_scale()
+{
+    const float native = ANativeWindow_getWidth(app_->window) / bundle_.value("screen-width");
+
+    // displays can switch rates between windows
+    scaler_.set_display_period(1000.0f / display_refresh_rate(app_->activity));
+    scaler_.set_range(std::min(bundle_.value("render-scale-min"), native),
+        std::min(bundle_.value("render-scale-max"), native), bundle_.value("render-scale-step"));
+    apply_render_scale();
+}
+
+void app_delegate::apply_render_scale()
+{
+    const int32_t window_width = ANativeWindow_getWidth(app_->window);
+    const int32_t width = static_cast<int32_t>(std::lround(scaler_.scale() * bundle_.value("screen-width")));
+
+    renderer_->set_render_width(width < window_width ? width : 0);
+    __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "rendering %d pixels wide for a %d pixel window",
+        std::min(width, window_width), window_width);
+}
+
 void app_delegate::handle_command(int32_t command)
 {
     switch (command)
     {
         case APP_CMD_INIT_WINDOW:
-            renderer_.reset(new renderer(app_->window));
-            renderer_->load_assets(bundle_, loader_);
+            resume_start_ = app_clock::monotonic();
+            if (renderer_ == nullptr)
+            {
+                renderer_.reset(new renderer(app_->window));
+                renderer_->set_program_cache(app_->activity->internalDataPath);
+                renderer_->load_assets(bundle_, loader_);
+                resume_path_ = "cold";
+            }
+            else
+            {
+                // the context normally survives, only the surface is new
+                resume_path_ = renderer_->attach_window(app_->window) ? "warm" : "context-lost";
+            }
+
+            reset_render_scale();
+
+            if (std::strcmp(resume_path_, "warm") != 0)
+            {
+                const program_build_stats programs = renderer_->program_stats();
+                __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "%zu programs from cache, %zu compiled in %.2f ms",
+                    programs.cached, programs.compiled, programs.micros * 0.001);
+            }
             break;
 
         case APP_CMD_TERM_WINDOW:
-            renderer_.reset();
+        {
+            const texture_residency r = renderer_->residency();
+            __android_log_print(ANDROID_LOG_INFO, LOG_TAG,
+                "textures: %zu resident, %zu KB of %zu KB, %zu KB kept, %zu uploads, %zu evictions",
+                r.resident, r.bytes / 1024, r.budget / 1024, r.kept_bytes / 1024, r.uploads, r.evictions);
+
+            renderer_->detach_window();
             break;
+        }
 
         case APP_CMD_LOST_FOCUS:
             clock_.set_paused(true);
-            save_value(score_path_, game_->best_score());
+            persistence_.save(stats_);
             break;
 
         case APP_CMD_GAINED_FOCUS:
@@ -160,7 +355,12 @@ int32_t app_delegate::handle_input(AInputEvent* event)
         const auto action = AMotionEvent_getAction(event);
         if (action == AMOTION_EVENT_ACTION_DOWN)
         {
-            game_->handle_tap_down();
+            // batched events carry their earliest sample in the history
+            const int64_t nanos = AMotionEvent_getHistorySize(event) > 0
+                ? AMotionEvent_getHistoricalEventTime(event, 0)
+                : AMotionEvent_getEventTime(event);
+
+            taps_.push(clock_.from_monotonic(nanos / 1000000));
         }
     }
 
@@ -2,6 +2,8 @@
 
 #include <android/asset_manager.h>
 
+#include <fstream>
+#include <iterator>
 #include <memory>
 
 namespace {
@@ -18,6 +20,18 @@ namespace {
         return asset(AAssetManager_open(am, p, AASSET_MODE_BUFFER), close_asset);
     };
 
+    template<class T>
+    bool load_override(const std::string& root, const std::string& path, T& out)
+    {
+        if (root.empty()) { return false; }
+
+        std::ifstream file { root + "/" + path, std::ios::binary };
+        if (!file.is_open()) { return false; }
+
+        out.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+
 }
 
 asset_loader::asset_loader(AAssetManager* asset_manager)
@@ -26,6 +40,9 @@ asset_loader::asset_loader(AAssetManager* asset_manager)
 
 std::vector<uint8_t> asset_loader::load_bytes(const std::string& path) const
 {
+    std::vector<uint8_t> bytes;
+    if (load_override(override_root_, path, bytes)) { return bytes; }
+
     auto asset = get_asset(asset_manager_, path.c_str());
     auto buffer = (const uint8_t*)AAsset_getBuffer(asset.get());
     return std::vector<uint8_t>(buffer, buffer + AAsset_getLength(asset.get()));
@@ -33,6 +50,9 @@ std::vector<uint8_t> asset_loader::load_bytes(const std::string& path) const
 
 std::string asset_loader::load_string(const std::string& path) const
 {
+    std::string text;
+    if (load_override(override_root_, path, text)) { return text; }
+
     auto asset = get_asset(asset_manager_, path.c_str());
     auto buffer = (const char*)AAsset_getBuffer(asset.get());
     return std::string(buffer, buffer + AAsset_getLength(asset.get()));
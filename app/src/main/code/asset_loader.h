@@ -1,6 +1,7 @@
 #ifndef ASSET_LOADER_H
 #define ASSET_LOADER_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -14,8 +15,12 @@ public:
     std::vector<uint8_t> load_bytes(const std::string& path) const;
     std::string load_string(const std::string& path) const;
 
+    // files under root take precedence over packaged assets
+    inline void set_override_root(const std::string& root) { override_root_ = root; }
+
 private:
     AAssetManager* asset_manager_;
+    std::string override_root_;
 };
 
 #endif
@@ -0,0 +1,89 @@
+#include "asset_watcher.h"
+
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+    const uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+
+}
+
+asset_watcher::asset_watcher(const std::string& root)
+    : fd_(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+    , root_(root)
+{
+    if (fd_ < 0) { throw std::runtime_error("inotify is not available"); }
+    watch("");
+}
+
+asset_watcher::~asset_watcher()
+{
+    close(fd_);
+}
+
+std::vector<std::string> asset_watcher::poll()
+{
+    std::vector<std::string> changes;
+    alignas(inotify_event) char buffer[4096];
+
+    while (true)
+    {
+        const ssize_t len = read(fd_, buffer, sizeof(buffer));
+        if (len <= 0) { break; }
+
+        for (ssize_t offset = 0; offset < len; )
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            auto dir = directories_.find(event->wd);
+            if (dir == directories_.end() || event->len == 0) { continue; }
+
+            const std::string path = dir->second + event->name;
+
+            if ((event->mask & IN_ISDIR) != 0)
+            {
+                if ((event->mask & (IN_CREATE | IN_MOVED_TO)) != 0) { watch(path + "/"); }
+                continue;
+            }
+
+            // IN_CREATE alone means the file is still being written
+            if ((event->mask & IN_CREATE) != 0) { continue; }
+
+            if (std::find(changes.begin(), changes.end(), path) == changes.end())
+            {
+                changes.push_back(path);
+            }
+        }
+    }
+
+    return changes;
+}
+
+void asset_watcher::watch(const std::string& directory)
+{
+    const std::string full = root_ + "/" + directory;
+
+    const int wd = inotify_add_watch(fd_, full.c_str(), WATCH_MASK);
+    if (wd < 0) { return; }
+    directories_[wd] = directory;
+
+    DIR* dir = opendir(full.c_str());
+    if (dir == nullptr) { return; }
+
+    while (const dirent* entry = readdir(dir))
+    {
+        const std::string name = entry->d_name;
+        if (entry->d_type == DT_DIR && name != "." && name != "..")
+        {
+            watch(directory + name + "/");
+        }
+    }
+
+    closedir(dir);
+}
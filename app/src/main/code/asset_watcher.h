@@ -0,0 +1,29 @@
+#ifndef ASSET_WATCHER_H
+#define ASSET_WATCHER_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reports files written under a directory tree, using inotify.
+class asset_watcher final
+{
+public:
+    explicit asset_watcher(const std::string& root);
+    ~asset_watcher();
+
+    asset_watcher(const asset_watcher&) = delete;
+    asset_watcher& operator=(const asset_watcher&) = delete;
+
+    // paths relative to root of files changed since the last call
+    std::vector<std::string> poll();
+
+private:
+    int fd_;
+    std::string root_;
+    std::unordered_map<int, std::string> directories_;
+
+    void watch(const std::string& directory);
+};
+
+#endif
@@ -0,0 +1,68 @@
+#include "bmp.h"
+
+#include <stdexcept>
+
+namespace {
+
+    inline uint32_t read_u32(const std::vector<uint8_t>& bytes, size_t offset)
+    {
+        return bytes[offset] | (bytes[offset + 1] << 8) | (bytes[offset + 2] << 16) |
+            (uint32_t(bytes[offset + 3]) << 24);
+    }
+
+}
+
+void decode_bmp(const std::vector<uint8_t>& bytes, uint32_t& width, uint32_t& height,
+    std::vector<uint8_t>& texels)
+{
+    static const uint32_t BMP_HEADER_SIZE = 54;
+    static const uint32_t BMP_DATA_OFFSET = 10;
+    static const uint32_t BMP_WIDTH_OFFSET = 18;
+    static const uint32_t BMP_HEIGHT_OFFSET = 22;
+    static const uint32_t BMP_BITS_OFFSET = 28;
+    static const uint32_t BMP_COMPRESSION_OFFSET = 30;
+    static const uint32_t CHANNELS_COUNT = 4;
+
+    if (bytes.size() < BMP_HEADER_SIZE || bytes[0] != 'B' || bytes[1] != 'M')
+    {
+        throw std::runtime_error("not a bmp");
+    }
+
+    if (bytes[BMP_BITS_OFFSET] != 24 || bytes[BMP_BITS_OFFSET + 1] != 0 || read_u32(bytes, BMP_COMPRESSION_OFFSET) != 0)
+    {
+        throw std::runtime_error("expected a 24-bit rgb bmp");
+    }
+
+    const uint32_t data = read_u32(bytes, BMP_DATA_OFFSET);
+    width = read_u32(bytes, BMP_WIDTH_OFFSET);
+    height = read_u32(bytes, BMP_HEIGHT_OFFSET);
+
+    // top-down images have a negative height
+    if (width == 0 || height == 0 || width > 0xffff || height > 0xffff)
+    {
+        throw std::runtime_error("expected a bottom-up bmp of 1 to 65535 pixels a side");
+    }
+
+    // rows are padded to 4 bytes
+    const size_t stride = (3 * size_t(width) + 3) & ~size_t(3);
+    if (data < BMP_HEADER_SIZE || bytes.size() < data + stride * height)
+    {
+        throw std::runtime_error("truncated bmp");
+    }
+
+    texels.resize(CHANNELS_COUNT * width * height);
+
+    uint8_t* t = texels.data();
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const uint8_t* row = &bytes[data + y * stride];
+        for (uint32_t x = 0; x < width; ++x, t += CHANNELS_COUNT)
+        {
+            uint8_t r = t[0] = row[3 * x + 2];
+            uint8_t g = t[1] = row[3 * x + 1];
+            uint8_t b = t[2] = row[3 * x];
+
+            t[3] = (uint8_t)((r == 0xff && g == 0x00 && b == 0xff) ? 0x00 : 0xff);
+        }
+    }
+}
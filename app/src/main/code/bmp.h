@@ -0,0 +1,12 @@
+#ifndef BMP_H
+#define BMP_H
+
+#include <cstdint>
+#include <vector>
+
+// Decodes a bottom-up 24-bit BMP to RGBA texels. Magenta becomes transparent.
+// Throws std::runtime_error when the header is not one or the file is short.
+void decode_bmp(const std::vector<uint8_t>& bytes, uint32_t& width, uint32_t& height,
+    std::vector<uint8_t>& texels);
+
+#endif
@@ -1,105 +1,306 @@
 #include "bundle.h"
 
-#include <sstream>
+#include "rect.h"
+#include "tokenizer.h"
+
+#include <stdexcept>
 
 namespace {
 
-    std::istream& operator>>(std::istream& s, blend_mode& bm)
+    blend_mode parse_blend_mode(tokenizer& t)
+    {
+        const text_view mode = t.word("blend mode");
+
+        if (mode == "blend-none") { return blend_mode::none; }
+        if (mode == "blend-alpha") { return blend_mode::alpha; }
+
+        t.fail("unsupported blend mode: " + mode.str());
+    }
+
+    pixel_format parse_pixel_format(tokenizer& t)
     {
-        std::string mode;
-        s >> mode;
+        const text_view format = t.word("pixel format");
 
-        if (mode == "blend-none") { bm = blend_mode::none; }
-        else if (mode == "blend-alpha") { bm = blend_mode::alpha; }
-        else { throw std::runtime_error("unsupported blend mode: " + mode); }
+        if (format == "rgba8888") { return pixel_format::rgba8888; }
+        if (format == "rgb565") { return pixel_format::rgb565; }
+        if (format == "rgba5551") { return pixel_format::rgba5551; }
 
-        return s;
+        t.fail("unsupported pixel format: " + format.str());
     }
 
 }
 
-std::istream& operator>>(std::istream& s, bundle& b)
+void parse_bundle(text_view text, bundle& b)
 {
     string_table<size_t> shaders_table, textures_table, materials_table;
-    std::string type, id;
+    tokenizer t { text };
 
-    while (s >> type >> id)
+    auto find = [&](const string_table<size_t>& table, const char* what) -> size_t
     {
+        const text_view id = t.word(what);
+
+        const size_t* index = table.find(id);
+        if (index == nullptr) { t.fail(std::string("unknown ") + what + ": " + id.str()); }
+        return *index;
+    };
+
+    while (t.next_line())
+    {
+        const text_view type = t.word("entry type");
+
         if (type == "shader")
         {
+            const text_view id = t.word("id");
+
             shader_source shader;
-            s >> shader.vert >> shader.frag;
+            shader.vert = t.word("vertex shader path").str();
+            shader.frag = t.word("fragment shader path").str();
 
             shaders_table.emplace(id, b.shaders_.size());
-            b.shaders_.emplace_back(shader);
+            b.shaders_.emplace_back(std::move(shader));
         }
         else if (type == "texture")
         {
+            const text_view id = t.word("id");
+
             texture_source texture;
-            s >> texture.path;
+            texture.path = t.word("texture path").str();
+            texture.width = t.integer();
+            texture.height = t.integer();
+            texture.format = pixel_format::rgba8888;
+            texture.dither = false;
+            texture.tiers.push_back(texture_tier { 1, { texture.path } });
 
             textures_table.emplace(id, b.textures_.size());
-            b.textures_.emplace_back(texture);
+            b.textures_.emplace_back(std::move(texture));
+        }
+        else if (type == "texture-format")
+        {
+            texture_source& texture = b.textures_[find(textures_table, "texture")];
+            texture.format = parse_pixel_format(t);
+            texture.dither = false;
+
+            if (!t.at_line_end())
+            {
+                if (t.word("dither") != "dither") { t.fail("expected dither or the end of the line"); }
+                texture.dither = true;
+            }
+        }
+        else if (type == "texture-tier")
+        {
+            texture_source& texture = b.textures_[find(textures_table, "texture")];
+
+            texture_tier tier;
+            tier.divisor = t.integer();
+            if (tier.divisor == 0 || (tier.divisor & (tier.divisor - 1)) != 0)
+            {
+                t.fail("tier divisor is not a power of two: " + std::to_string(tier.divisor));
+            }
+
+            if (texture.width % tier.divisor != 0 || texture.height % tier.divisor != 0)
+            {
+                t.fail("tier divisor does not divide the texture size: " + std::to_string(tier.divisor));
+            }
+
+            tier.levels.push_back(t.word("tier path").str());
+            while (!t.at_line_end()) { tier.levels.push_back(t.word("mip level path").str()); }
+
+            // a tier of the same divisor, e.g. 1 for mip levels of the full page, replaces it
+            auto it = texture.tiers.begin();
+            while (it != texture.tiers.end() && it->divisor < tier.divisor) { ++it; }
+
+            if (it != texture.tiers.end() && it->divisor == tier.divisor) { *it = std::move(tier); }
+            else { texture.tiers.insert(it, std::move(tier)); }
         }
         else if (type == "material")
         {
+            const text_view id = t.word("id");
+
             material_source material;
-            std::string texture_id, shader_id;
+            material.blend = parse_blend_mode(t);
+            material.shader = find(shaders_table, "shader");
+            material.texture = find(textures_table, "texture");
 
-            s >> material.blend >> shader_id >> texture_id;
-            material.shader = shaders_table[shader_id];
-            material.texture = textures_table[texture_id];
+            material.batch_key = b.materials_.size();
+            for (const auto& other: b.materials_)
+            {
+                if (other.shader == material.shader && other.blend == material.blend)
+                {
+                    material.batch_key = other.batch_key;
+                    break;
+                }
+            }
 
             materials_table.emplace(id, b.materials_.size());
             b.materials_.emplace_back(material);
         }
         else if (type == "sprite")
         {
+            const text_view id = t.word("id");
+
             sprite sprite;
-            std::string material_id;
+            sprite.material = find(materials_table, "material");
+            sprite.outline = nullptr;
+            sprite.outline_size = 0;
+            sprite.rect.left = t.number();
+            sprite.rect.right = t.number();
+            sprite.rect.bottom = t.number();
+            sprite.rect.top = t.number();
+            sprite.origin.x = t.number();
+            sprite.origin.y = t.number();
+
+            const auto& texture = b.textures_[b.materials_[sprite.material].texture];
+            sprite.uv.left = sprite.rect.left / texture.width;
+            sprite.uv.right = sprite.rect.right / texture.width;
+            sprite.uv.bottom = sprite.rect.bottom / texture.height;
+            sprite.uv.top = sprite.rect.top / texture.height;
 
-            s >> material_id
-                >> sprite.rect.left >> sprite.rect.right
-                >> sprite.rect.bottom >> sprite.rect.top
-                >> sprite.origin.x >> sprite.origin.y;
+            b.sprites_table_.emplace(id, b.sprites_.size());
+            b.sprites_.emplace_back(sprite);
+        }
+        else if (type == "sprite-uv")
+        {
+            const text_view id = t.word("id");
 
-            sprite.material = materials_table[material_id];
+            sprite sprite;
+            sprite.material = find(materials_table, "material");
+            sprite.outline = nullptr;
+            sprite.outline_size = 0;
+            sprite.rect.left = 0.0f;
+            sprite.rect.bottom = 0.0f;
+            sprite.rect.right = t.number();
+            sprite.rect.top = t.number();
+            sprite.origin.x = t.number();
+            sprite.origin.y = t.number();
+            sprite.uv.left = t.number();
+            sprite.uv.right = t.number();
+            sprite.uv.bottom = t.number();
+            sprite.uv.top = t.number();
 
             b.sprites_table_.emplace(id, b.sprites_.size());
             b.sprites_.emplace_back(sprite);
         }
+        else if (type == "sprite-mesh")
+        {
+            sprite& sprite = b.sprites_[find(b.sprites_table_, "sprite")];
+            const vec2 size = rect_size(sprite.rect);
+
+            std::vector<vec2> outline;
+            while (!t.at_line_end())
+            {
+                if (outline.size() == MAX_OUTLINE_POINTS)
+                {
+                    t.fail("sprite mesh has more than " + std::to_string(MAX_OUTLINE_POINTS) + " points");
+                }
+
+                // points are in pixels from the bottom left corner of the rect
+                vec2 p;
+                p.x = t.number() / size.x;
+                p.y = t.number() / size.y;
+                outline.push_back(p);
+            }
+
+            if (outline.size() < 3) { t.fail("sprite mesh needs at least 3 points"); }
+
+            // copies taken by arrays, clips and fonts before this line keep the rect
+            b.outlines_.emplace_back(std::move(outline));
+            sprite.outline = b.outlines_.back().data();
+            sprite.outline_size = static_cast<uint32_t>(b.outlines_.back().size());
+        }
         else if (type == "sprite-array")
         {
+            const text_view id = t.word("id");
+
             std::vector<size_t> set;
-            std::string sprites;
-            std::getline(s, sprites);
-            std::stringstream line { sprites };
+            while (!t.at_line_end()) { set.push_back(find(b.sprites_table_, "sprite")); }
 
-            std::string sprite_id;
-            while (line >> sprite_id)
+            b.arrays_table_.emplace(id, std::move(set));
+        }
+        else if (type == "clip")
+        {
+            const text_view id = t.word("id");
+
+            clip_source clip;
+            clip.rate = t.integer();
+            clip.first_frame = b.clip_frames_.size();
+
+            while (!t.at_line_end())
             {
-                set.push_back(b.sprites_table_.at(sprite_id));
+                b.clip_frames_.push_back(b.sprites_[find(b.sprites_table_, "sprite")]);
             }
 
-            b.arrays_table_.emplace(id, std::move(set));
+            clip.frame_count = b.clip_frames_.size() - clip.first_frame;
+
+            b.clips_table_.emplace(id, b.clips_.size());
+            b.clips_.emplace_back(clip);
+        }
+        else if (type == "font")
+        {
+            const text_view id = t.word("id");
+
+            font_source font;
+            font.spacing = t.number();
+            font.codes = t.word("character codes").str();
+
+            while (!t.at_line_end())
+            {
+                font.glyphs.push_back(b.sprites_[find(b.sprites_table_, "sprite")]);
+            }
+
+            if (font.glyphs.size() != font.codes.size())
+            {
+                t.fail("glyph count does not match codes in font: " + id.str());
+            }
+
+            for (const auto& glyph: font.glyphs)
+            {
+                if (glyph.material != font.glyphs.front().material)
+                {
+                    t.fail("glyphs use different materials in font: " + id.str());
+                }
+            }
+
+            b.fonts_table_.emplace(id, std::move(font));
+        }
+        else if (type == "kerning")
+        {
+            const text_view font_id = t.word("font");
+
+            font_source* font = b.fonts_table_.find(font_id);
+            if (font == nullptr) { t.fail("unknown font: " + font_id.str()); }
+
+            const text_view pair = t.word("character pair");
+            if (pair.size != 2) { t.fail("kerning expects two characters: " + pair.str()); }
+
+            kerning_pair kerning;
+            kerning.left = pair.data[0];
+            kerning.right = pair.data[1];
+            kerning.offset = t.number();
+
+            font->kerning.push_back(kerning);
         }
         else if (type == "value")
         {
-            float number;
-            s >> number;
+            const text_view id = t.word("id");
+            const float number = t.number();
             b.values_table_.emplace(id, number);
         }
-    }
+        else
+        {
+            // tool-only lines, e.g. atlas manifests
+            continue;
+        }
 
-    return s;
+        t.expect_line_end();
+    }
 }
 
-sprite bundle::sprite(const std::string& name) const
+sprite bundle::sprite(const string_key& name) const
 {
     return sprites_[sprites_table_.at(name)];
 }
 
-std::vector<sprite> bundle::sprite_array(const std::string& name) const
+std::vector<sprite> bundle::sprite_array(const string_key& name) const
 {
     const auto& indices = arrays_table_.at(name);
     std::vector<struct sprite> sprites;
@@ -110,7 +311,30 @@ std::vector<sprite> bundle::sprite_array(const std::string& name) const
     return std::move(sprites);
 }
 
-float bundle::value(const std::string& name) const
+size_t bundle::clip(const string_key& name) const
+{
+    return clips_table_.at(name);
+}
+
+const font_source& bundle::font(const string_key& name) const
+{
+    return fonts_table_.at(name);
+}
+
+float bundle::value(const string_key& name) const
 {
     return values_table_.at(name);
 }
+
+bool bundle::patch_entry(text_view line)
+{
+    tokenizer t { line };
+    if (!t.next_line() || t.word("entry type") != "value") { return false; }
+
+    const text_view id = t.word("id");
+    const float number = t.number();
+    t.expect_line_end();
+
+    values_table_[id] = number;
+    return true;
+}
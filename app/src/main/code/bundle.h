@@ -3,11 +3,13 @@
 
 #include "types.h"
 #include "sprite.h"
+#include "string_table.h"
+#include "text_view.h"
 
-#include <iosfwd>
+#include <cstdint>
+#include <deque>
 #include <string>
 #include <vector>
-#include <unordered_map>
 
 struct shader_source
 {
@@ -15,9 +17,24 @@ struct shader_source
     std::string frag;
 };
 
+// One resolution of a texture page: 1/divisor of the full size. Paths after
+// the first are offline-built mip levels, each half the size of the previous.
+struct texture_tier
+{
+    uint32_t divisor;
+    std::vector<std::string> levels;
+};
+
 struct texture_source
 {
     std::string path;
+    uint32_t width;
+    uint32_t height;
+    // what the texels are stored as on the GPU, converted at load time
+    pixel_format format;
+    bool dither;
+    // ascending divisors, the first is the full resolution page at path
+    std::vector<texture_tier> tiers;
 };
 
 struct material_source
@@ -25,31 +42,78 @@ struct material_source
     blend_mode blend;
     size_t shader;
     size_t texture;
+    // first material with the same shader and blend mode, drawn together
+    // whatever their textures
+    size_t batch_key;
+};
+
+struct kerning_pair
+{
+    char left;
+    char right;
+    float offset;
 };
 
-template<class T>
-using string_table = std::unordered_map<std::string, T>;
+struct font_source
+{
+    float spacing;
+    std::string codes;
+    std::vector<struct sprite> glyphs;
+    std::vector<kerning_pair> kerning;
+};
 
+struct clip_source
+{
+    size_t first_frame;
+    size_t frame_count;
+    uint32_t rate;
+};
+
+class bundle;
+
+// Reads bundle.txt. Fails with the line and column of the first bad token.
+void parse_bundle(text_view text, bundle& b);
+
+// Sprites point into the bundle for their outlines, so it outlives them and
+// is never copied.
 class bundle final
 {
 public:
+    bundle() = default;
+    bundle(const bundle&) = delete;
+    bundle& operator=(const bundle&) = delete;
+
     inline const std::vector<shader_source>& shaders() const { return shaders_; }
     inline const std::vector<texture_source>& textures() const { return textures_; }
     inline const std::vector<material_source>& materials() const { return materials_; }
+    inline const std::vector<clip_source>& clips() const { return clips_; }
+    inline const std::vector<struct sprite>& clip_frames() const { return clip_frames_; }
+
+    struct sprite sprite(const string_key& name) const;
+    std::vector<struct sprite> sprite_array(const string_key& name) const;
+    size_t clip(const string_key& name) const;
+    const font_source& font(const string_key& name) const;
+    float value(const string_key& name) const;
 
-    struct sprite sprite(const std::string& name) const;
-    std::vector<struct sprite> sprite_array(const std::string& name) const;
-    float value(const std::string& name) const;
+    // applies one changed bundle line in place; only value entries can be
+    // patched, false is returned for everything else
+    bool patch_entry(text_view line);
 
 private:
-    friend std::istream& operator>>(std::istream& s, bundle& b);
+    friend void parse_bundle(text_view text, bundle& b);
 
     std::vector<shader_source> shaders_;
     std::vector<texture_source> textures_;
     std::vector<material_source> materials_;
     std::vector<struct sprite> sprites_;
+    std::vector<clip_source> clips_;
+    std::vector<struct sprite> clip_frames_;
+    // sprite-mesh points; a deque, so points never move once sprites refer to them
+    std::deque<std::vector<vec2>> outlines_;
     string_table<size_t> sprites_table_;
     string_table<std::vector<size_t>> arrays_table_;
+    string_table<size_t> clips_table_;
+    string_table<font_source> fonts_table_;
     string_table<float> values_table_;
 };
 
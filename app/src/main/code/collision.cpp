@@ -0,0 +1,95 @@
+#include "collision.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace {
+
+    inline float dot(vec2 a, vec2 b)
+    {
+        return a.x * b.x + a.y * b.y;
+    }
+
+    bool segment_rect(vec2 p, vec2 d, const rect& b, float& t)
+    {
+        const float origin[] = { p.x, p.y };
+        const float dir[] = { d.x, d.y };
+        const float low[] = { b.left, b.bottom };
+        const float high[] = { b.right, b.top };
+
+        float enter = 0.0f;
+        float leave = 1.0f;
+
+        for (size_t i = 0; i < 2; ++i)
+        {
+            if (dir[i] == 0.0f)
+            {
+                if (origin[i] < low[i] || origin[i] > high[i]) { return false; }
+                continue;
+            }
+
+            float t0 = (low[i] - origin[i]) / dir[i];
+            float t1 = (high[i] - origin[i]) / dir[i];
+            if (t0 > t1) { std::swap(t0, t1); }
+
+            enter = std::max(enter, t0);
+            leave = std::min(leave, t1);
+            if (enter > leave) { return false; }
+        }
+
+        t = enter;
+        return true;
+    }
+
+    bool segment_circle(vec2 p, vec2 d, vec2 center, float radius, float& t)
+    {
+        const vec2 m { p.x - center.x, p.y - center.y };
+        const float c = dot(m, m) - radius * radius;
+        if (c <= 0.0f)
+        {
+            t = 0.0f;
+            return true;
+        }
+
+        const float a = dot(d, d);
+        const float b = dot(m, d);
+        if (a == 0.0f || b >= 0.0f) { return false; }
+
+        const float discriminant = b * b - a * c;
+        if (discriminant < 0.0f) { return false; }
+
+        const float root = (-b - std::sqrt(discriminant)) / a;
+        if (root > 1.0f) { return false; }
+
+        t = root;
+        return true;
+    }
+
+}
+
+bool sweep_circle_rect(vec2 from, vec2 delta, float radius, const rect& box, float& toi)
+{
+    // the box grown by the radius is the union of two crossed boxes and
+    // a circle at every corner
+    const rect wide { box.left - radius, box.right + radius, box.bottom, box.top };
+    const rect tall { box.left, box.right, box.bottom - radius, box.top + radius };
+    const vec2 corners[] = {
+        { box.left, box.bottom }, { box.right, box.bottom },
+        { box.left, box.top }, { box.right, box.top }
+    };
+
+    bool hit = false;
+    float t;
+    toi = 1.0f;
+
+    if (segment_rect(from, delta, wide, t)) { toi = std::min(toi, t); hit = true; }
+    if (segment_rect(from, delta, tall, t)) { toi = std::min(toi, t); hit = true; }
+
+    for (const vec2& corner: corners)
+    {
+        if (segment_circle(from, delta, corner, radius, t)) { toi = std::min(toi, t); hit = true; }
+    }
+
+    return hit;
+}
@@ -0,0 +1,11 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include "types.h"
+
+// Moves a circle of the given radius from `from` by `delta` and finds the
+// first moment it touches the box. toi is the fraction of delta travelled,
+// 0 when the circle overlaps the box from the start.
+bool sweep_circle_rect(vec2 from, vec2 delta, float radius, const rect& box, float& toi);
+
+#endif
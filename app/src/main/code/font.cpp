@@ -0,0 +1,37 @@
+#include "font.h"
+
+#include "bundle.h"
+
+#include <algorithm>
+
+font::font(const font_source& source)
+    : spacing_(source.spacing)
+    , material_(source.glyphs.empty() ? 0 : source.glyphs.front().material)
+    , glyphs_(source.glyphs)
+    , kerning_(source.kerning)
+{
+    std::fill(glyph_index_, glyph_index_ + NUM_CODES, -1);
+
+    for (size_t i = 0; i < source.codes.size(); ++i)
+    {
+        const auto code = static_cast<unsigned char>(source.codes[i]);
+        if (code < NUM_CODES) { glyph_index_[code] = static_cast<int16_t>(i); }
+    }
+}
+
+const sprite* font::glyph(char c) const
+{
+    const auto code = static_cast<unsigned char>(c);
+    if (code >= NUM_CODES || glyph_index_[code] < 0) { return nullptr; }
+    return &glyphs_[glyph_index_[code]];
+}
+
+float font::kerning(char left, char right) const
+{
+    for (const auto& k: kerning_)
+    {
+        if (k.left == left && k.right == right) { return k.offset; }
+    }
+
+    return 0.0f;
+}
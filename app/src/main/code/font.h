@@ -0,0 +1,34 @@
+#ifndef FONT_H
+#define FONT_H
+
+#include "sprite.h"
+
+#include <cstdint>
+#include <vector>
+
+struct font_source;
+struct kerning_pair;
+
+class font final
+{
+public:
+    explicit font(const font_source& source);
+
+    // nullptr for characters the font has no glyph for
+    const sprite* glyph(char c) const;
+    float kerning(char left, char right) const;
+
+    inline float spacing() const { return spacing_; }
+    inline size_t material() const { return material_; }
+
+private:
+    static const size_t NUM_CODES = 128;
+
+    float spacing_;
+    size_t material_;
+    int16_t glyph_index_[NUM_CODES];
+    std::vector<sprite> glyphs_;
+    std::vector<kerning_pair> kerning_;
+};
+
+#endif
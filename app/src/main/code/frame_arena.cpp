@@ -0,0 +1,29 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+frame_arena::frame_arena(size_t capacity)
+    : memory_(new uint8_t[capacity])
+    , capacity_(capacity)
+    , used_(0)
+    , peak_(0)
+{}
+
+void frame_arena::reset()
+{
+    used_ = 0;
+}
+
+void* frame_arena::allocate_bytes(size_t size, size_t alignment)
+{
+    const auto base = reinterpret_cast<uintptr_t>(memory_.get());
+    const uintptr_t start = (base + used_ + alignment - 1) & ~(uintptr_t(alignment) - 1);
+    const size_t end = start - base + size;
+
+    if (end > capacity_) { throw std::runtime_error("frame arena exhausted"); }
+
+    used_ = end;
+    peak_ = std::max(peak_, used_);
+    return reinterpret_cast<void*>(start);
+}
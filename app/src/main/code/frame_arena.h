@@ -0,0 +1,36 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Linear allocator for data that lives for one frame. Memory is reserved
+// once; reset() releases everything at the start of the next frame.
+class frame_arena final
+{
+public:
+    explicit frame_arena(size_t capacity);
+
+    template<class T>
+    inline T* allocate(size_t count)
+    {
+        return static_cast<T*>(allocate_bytes(sizeof(T) * count, alignof(T)));
+    }
+
+    void reset();
+
+    inline size_t used() const { return used_; }
+    inline size_t peak() const { return peak_; }
+    inline size_t capacity() const { return capacity_; }
+
+private:
+    std::unique_ptr<uint8_t[]> memory_;
+    size_t capacity_;
+    size_t used_;
+    size_t peak_;
+
+    void* allocate_bytes(size_t size, size_t alignment);
+};
+
+#endif
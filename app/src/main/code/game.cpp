@@ -1,5 +1,6 @@
 #include "game.h"
 
+#include "animation.h"
 #include "bundle.h"
 #include "renderer.h"
 #include "user_interface.h"
@@ -7,8 +8,10 @@
 
 game::game(uint32_t score, const bundle& b)
     : screen_width_(b.value("screen-width"))
-    , world_(new world(score, b))
-    , user_interface_(new user_interface(b))
+    , overdraw_view_(b.value("overdraw-view") != 0.0f)
+    , animations_(new animation_system(b))
+    , world_(new world(score, b, *animations_))
+    , user_interface_(new user_interface(b, *animations_))
 {}
 
 game::~game() {}
@@ -21,6 +24,8 @@ void game::integrate(int64_t dt)
 void game::draw(renderer* r)
 {
     r->set_screen_width(screen_width_);
+    r->set_overdraw_view(overdraw_view_);
+    animations_->advance(r->frame_delta());
     world_->draw(r);
     user_interface_->draw(r, world_->state());
 }
@@ -30,7 +35,34 @@ void game::handle_tap_down()
     world_->handle_tap();
 }
 
+void game::apply_settings(const bundle& b)
+{
+    screen_width_ = b.value("screen-width");
+    overdraw_view_ = b.value("overdraw-view") != 0.0f;
+    world_->apply_settings(b);
+}
+
 uint32_t game::best_score() const
 {
     return world_->state().best_score;
 }
+
+const game_state& game::state() const
+{
+    return world_->state();
+}
+
+const simulation& game::rules() const
+{
+    return world_->rules();
+}
+
+const simulation_state& game::snapshot() const
+{
+    return world_->snapshot();
+}
+
+void game::restore(const simulation_state& s)
+{
+    world_->restore(s);
+}
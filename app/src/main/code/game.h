@@ -5,8 +5,11 @@
 
 #include <memory>
 
+class animation_system;
 class bundle;
 class renderer;
+class simulation;
+struct simulation_state;
 class user_interface;
 class world;
 
@@ -19,11 +22,20 @@ public:
     void integrate(int64_t dt);
     void draw(renderer* r);
     void handle_tap_down();
+    void apply_settings(const bundle& b);
 
     uint32_t best_score() const;
+    const game_state& state() const;
+
+    // for look-ahead bots, see simulation::rollout
+    const simulation& rules() const;
+    const simulation_state& snapshot() const;
+    void restore(const simulation_state& s);
 
 private:
     float screen_width_;
+    bool overdraw_view_;
+    std::unique_ptr<animation_system> animations_;
     std::unique_ptr<world> world_;
     std::unique_ptr<user_interface> user_interface_;
 };
@@ -12,6 +12,7 @@ struct game_state
     uint32_t score = 0;
     bool new_best = false;
     int64_t timer = 0;
+    uint32_t runs = 0; // finished since start
 };
 
 #endif
@@ -0,0 +1,94 @@
+#include "hot_reload.h"
+
+#include "asset_loader.h"
+#include "bundle.h"
+#include "game.h"
+#include "renderer.h"
+
+#include <android/log.h>
+#include <sys/stat.h>
+
+#include <chrono>
+#include <sstream>
+
+namespace {
+
+    const char* LOG_TAG = "hot-reload";
+    const char* BUNDLE_PATH = "bundle.txt";
+
+    std::unordered_set<std::string> split_lines(const std::string& text)
+    {
+        std::unordered_set<std::string> lines;
+        std::stringstream s { text };
+        std::string line;
+        while (std::getline(s, line)) { lines.insert(line); }
+        return lines;
+    }
+
+    const std::string& make_root(const std::string& root)
+    {
+        mkdir(root.c_str(), 0770);
+        return root;
+    }
+
+}
+
+hot_reload::hot_reload(const std::string& root, const std::string& bundle_text)
+    : watcher_(make_root(root))
+    , bundle_lines_(split_lines(bundle_text))
+{
+    __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "watching %s", root.c_str());
+}
+
+void hot_reload::update(bundle& b, game& g, renderer* r, const asset_loader& loader)
+{
+    for (const auto& path: watcher_.poll())
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        try
+        {
+            if (path == BUNDLE_PATH)
+            {
+                update_bundle(b, g, loader.load_string(path));
+            }
+
+            for (size_t i = 0; r != nullptr && i < b.shaders().size(); ++i)
+            {
+                const auto& shader = b.shaders()[i];
+                if (shader.vert != path && shader.frag != path) { continue; }
+                r->reload_shader(i, loader.load_string(shader.vert), loader.load_string(shader.frag));
+            }
+
+            // the renderer knows which tier, and so which files, each page reads
+            if (r != nullptr) { r->reload_texture(path, loader); }
+        }
+        catch (const std::exception& e)
+        {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "%s: %s", path.c_str(), e.what());
+            continue;
+        }
+
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "%s reloaded in %.2f ms", path.c_str(),
+            std::chrono::duration<double, std::milli>(elapsed).count());
+    }
+}
+
+void hot_reload::update_bundle(bundle& b, game& g, const std::string& text)
+{
+    auto lines = split_lines(text);
+
+    for (const auto& line: lines)
+    {
+        if (line.empty() || bundle_lines_.count(line) != 0) { continue; }
+
+        if (!b.patch_entry(line))
+        {
+            __android_log_print(ANDROID_LOG_WARN, LOG_TAG, "needs restart: %s", line.c_str());
+        }
+    }
+
+    bundle_lines_ = std::move(lines);
+    g.apply_settings(b);
+}
@@ -0,0 +1,32 @@
+#ifndef HOT_RELOAD_H
+#define HOT_RELOAD_H
+
+#include "asset_watcher.h"
+
+#include <string>
+#include <unordered_set>
+
+class asset_loader;
+class bundle;
+class game;
+class renderer;
+
+// Development-only live reload of assets pushed under root. Changed bundle
+// values are patched into the running game, changed shaders and textures
+// replace their GPU resources in place.
+class hot_reload final
+{
+public:
+    hot_reload(const std::string& root, const std::string& bundle_text);
+
+    // renderer is null while there is no window
+    void update(bundle& b, game& g, renderer* r, const asset_loader& loader);
+
+private:
+    asset_watcher watcher_;
+    std::unordered_set<std::string> bundle_lines_;
+
+    void update_bundle(bundle& b, game& g, const std::string& text);
+};
+
+#endif
@@ -0,0 +1,52 @@
+#include "mip_chain.h"
+
+#include <algorithm>
+#include <utility>
+
+void halve_texels(const std::vector<uint8_t>& texels, uint32_t width, uint32_t height,
+    std::vector<uint8_t>& half)
+{
+    const uint32_t half_width = mip_size(width, 1);
+    const uint32_t half_height = mip_size(height, 1);
+    half.resize(4 * half_width * half_height);
+
+    for (uint32_t y = 0; y < half_height; ++y)
+    {
+        const uint32_t rows[] = { 2 * y, std::min(2 * y + 1, height - 1) };
+
+        for (uint32_t x = 0; x < half_width; ++x)
+        {
+            const uint32_t columns[] = { 2 * x, std::min(2 * x + 1, width - 1) };
+            uint32_t sum[4] = { 0, 0, 0, 0 };
+
+            for (uint32_t row: rows)
+            {
+                for (uint32_t column: columns)
+                {
+                    const uint8_t* t = &texels[4 * (row * width + column)];
+                    sum[0] += t[0] * t[3];
+                    sum[1] += t[1] * t[3];
+                    sum[2] += t[2] * t[3];
+                    sum[3] += t[3];
+                }
+            }
+
+            uint8_t* out = &half[4 * (y * half_width + x)];
+            for (size_t c = 0; c < 3; ++c)
+            {
+                out[c] = static_cast<uint8_t>(sum[3] != 0 ? (sum[c] + sum[3] / 2) / sum[3] : 0);
+            }
+            out[3] = static_cast<uint8_t>((sum[3] + 2) / 4);
+        }
+    }
+}
+
+void complete_mip_chain(std::vector<std::vector<uint8_t>>& levels, uint32_t width, uint32_t height)
+{
+    for (size_t level = levels.size(); mip_size(width, level - 1) > 1 || mip_size(height, level - 1) > 1; ++level)
+    {
+        std::vector<uint8_t> half;
+        halve_texels(levels[level - 1], mip_size(width, level - 1), mip_size(height, level - 1), half);
+        levels.emplace_back(std::move(half));
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef MIP_CHAIN_H
+#define MIP_CHAIN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Halves RGBA texels with a 2x2 box filter, odd edges repeat their last row
+// or column. Colors are weighted by alpha, so transparent texels do not
+// darken the edges of visible ones.
+void halve_texels(const std::vector<uint8_t>& texels, uint32_t width, uint32_t height,
+    std::vector<uint8_t>& half);
+
+// halves the last level until it is 1x1; levels[0] is width x height
+void complete_mip_chain(std::vector<std::vector<uint8_t>>& levels, uint32_t width, uint32_t height);
+
+inline uint32_t mip_size(uint32_t size, size_t level)
+{
+    const uint32_t s = size >> level;
+    return s != 0 ? s : 1;
+}
+
+#endif
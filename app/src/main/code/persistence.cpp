@@ -0,0 +1,192 @@
+#include "persistence.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+    const uint32_t RECORD_MAGIC = 0x54534654; // "TFST"
+    const uint32_t RECORD_VERSION = 1;
+    const size_t RECORD_SIZE = 4 + 4 + 4 + 4 + 8 + 4 * player_stats::HISTOGRAM_BUCKETS + 4;
+
+    // all fields little-endian
+    void put_u32(uint8_t*& p, uint32_t v)
+    {
+        for (size_t i = 0; i < 4; ++i) { *p++ = uint8_t(v >> (8 * i)); }
+    }
+
+    void put_u64(uint8_t*& p, uint64_t v)
+    {
+        for (size_t i = 0; i < 8; ++i) { *p++ = uint8_t(v >> (8 * i)); }
+    }
+
+    uint32_t get_u32(const uint8_t*& p)
+    {
+        uint32_t v = 0;
+        for (size_t i = 0; i < 4; ++i) { v |= uint32_t(*p++) << (8 * i); }
+        return v;
+    }
+
+    uint64_t get_u64(const uint8_t*& p)
+    {
+        uint64_t v = 0;
+        for (size_t i = 0; i < 8; ++i) { v |= uint64_t(*p++) << (8 * i); }
+        return v;
+    }
+
+    uint32_t checksum(const uint8_t* data, size_t size)
+    {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < size; ++i) { hash = (hash ^ data[i]) * 16777619u; }
+        return hash;
+    }
+
+    bool write_all(int fd, const uint8_t* data, size_t size)
+    {
+        while (size > 0)
+        {
+            const ssize_t written = ::write(fd, data, size);
+            if (written < 0) { return false; }
+            data += written;
+            size -= size_t(written);
+        }
+        return true;
+    }
+
+}
+
+void player_stats::record_run(uint32_t points)
+{
+    best_score = std::max(best_score, points);
+    ++runs;
+    total_points += points;
+
+    const size_t bucket = std::min<size_t>(points / HISTOGRAM_BUCKET_SIZE, HISTOGRAM_BUCKETS - 1);
+    ++histogram[bucket];
+}
+
+persistence::persistence(const std::string& directory)
+    : path_(directory + "/stats.bin")
+    , temp_path_(directory + "/stats.bin.tmp")
+    , legacy_path_(directory + "/points")
+    , directory_(directory)
+{
+    worker_ = std::thread([this] { run(); });
+}
+
+persistence::~persistence()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();
+}
+
+player_stats persistence::load() const
+{
+    player_stats stats;
+
+    std::ifstream record { path_, std::ios::binary };
+    if (record.is_open())
+    {
+        uint8_t bytes[RECORD_SIZE];
+        record.read(reinterpret_cast<char*>(bytes), RECORD_SIZE);
+
+        const uint8_t* p = bytes;
+        if (record.gcount() == std::streamsize(RECORD_SIZE) &&
+            get_u32(p) == RECORD_MAGIC && get_u32(p) == RECORD_VERSION)
+        {
+            stats.best_score = get_u32(p);
+            stats.runs = get_u32(p);
+            stats.total_points = get_u64(p);
+            for (auto& count: stats.histogram) { count = get_u32(p); }
+
+            if (get_u32(p) == checksum(bytes, RECORD_SIZE - 4)) { return stats; }
+        }
+
+        stats = player_stats();
+    }
+
+    std::ifstream legacy { legacy_path_ };
+    if (legacy.is_open()) { legacy >> stats.best_score; }
+
+    return stats;
+}
+
+void persistence::save(const player_stats& stats)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = stats;
+        has_pending_ = true;
+    }
+    wake_.notify_one();
+}
+
+void persistence::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true)
+    {
+        wake_.wait(lock, [this] { return has_pending_ || stopping_; });
+
+        if (has_pending_)
+        {
+            const player_stats stats = pending_;
+            has_pending_ = false;
+
+            lock.unlock();
+            // the record replaces the legacy score file once it is durable
+            if (write(stats)) { unlink(legacy_path_.c_str()); }
+            lock.lock();
+        }
+        else if (stopping_)
+        {
+            return;
+        }
+    }
+}
+
+bool persistence::write(const player_stats& stats) const
+{
+    uint8_t bytes[RECORD_SIZE];
+    uint8_t* p = bytes;
+
+    put_u32(p, RECORD_MAGIC);
+    put_u32(p, RECORD_VERSION);
+    put_u32(p, stats.best_score);
+    put_u32(p, stats.runs);
+    put_u64(p, stats.total_points);
+    for (auto count: stats.histogram) { put_u32(p, count); }
+    put_u32(p, checksum(bytes, RECORD_SIZE - 4));
+
+    const int fd = open(temp_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) { return false; }
+
+    const bool written = write_all(fd, bytes, RECORD_SIZE) && fsync(fd) == 0;
+    close(fd);
+
+    if (!written || rename(temp_path_.c_str(), path_.c_str()) != 0)
+    {
+        unlink(temp_path_.c_str());
+        return false;
+    }
+
+    // make the rename itself durable
+    const int dir = open(directory_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir >= 0)
+    {
+        fsync(dir);
+        close(dir);
+    }
+
+    return true;
+}
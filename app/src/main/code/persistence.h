@@ -0,0 +1,62 @@
+#ifndef PERSISTENCE_H
+#define PERSISTENCE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct player_stats
+{
+    static const size_t HISTOGRAM_BUCKETS = 16;
+    static const uint32_t HISTOGRAM_BUCKET_SIZE = 5;
+
+    uint32_t best_score = 0;
+    uint32_t runs = 0;
+    uint64_t total_points = 0;
+    // runs by score, the last bucket takes everything above
+    uint32_t histogram[HISTOGRAM_BUCKETS] = {};
+
+    void record_run(uint32_t points);
+};
+
+// Keeps player_stats in a small binary record. Saving only hands a copy to a
+// background thread, which writes a temp file, fsyncs it and renames it over
+// the record, so a crash leaves either the old or the new record.
+class persistence final
+{
+public:
+    explicit persistence(const std::string& directory);
+    // writes whatever is still pending
+    ~persistence();
+
+    persistence(const persistence&) = delete;
+    persistence& operator=(const persistence&) = delete;
+
+    // falls back to the score file of older versions
+    player_stats load() const;
+
+    // never waits for storage; saves made while a write is in flight are
+    // merged into one write of the latest stats
+    void save(const player_stats& stats);
+
+private:
+    std::string path_;
+    std::string temp_path_;
+    std::string legacy_path_;
+    std::string directory_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    player_stats pending_;
+    bool has_pending_ = false;
+    bool stopping_ = false;
+    std::thread worker_;
+
+    void run();
+    bool write(const player_stats& stats) const;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include "pixel_format.h"
+
+#include <cstring>
+
+namespace {
+
+    const uint32_t BAYER[4][4] = {
+        {  0,  8,  2, 10 },
+        { 12,  4, 14,  6 },
+        {  3, 11,  1,  9 },
+        { 15,  7, 13,  5 },
+    };
+
+    // floor(v * max / 255 + bias / 32), so a bias of 16 rounds to nearest
+    inline uint32_t quantize(uint32_t v, uint32_t max, uint32_t bias)
+    {
+        return (v * max * 32 + bias * 255) / (255 * 32);
+    }
+
+}
+
+void pack_texels(std::vector<uint8_t>& texels, uint32_t width, uint32_t height,
+    pixel_format format, bool dither)
+{
+    if (format == pixel_format::rgba8888) { return; }
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            const size_t i = size_t(y) * width + x;
+            const uint32_t r = texels[4 * i], g = texels[4 * i + 1], b = texels[4 * i + 2], a = texels[4 * i + 3];
+            const uint32_t bias = dither ? 2 * BAYER[y & 3][x & 3] + 1 : 16;
+
+            const uint16_t packed = static_cast<uint16_t>(format == pixel_format::rgb565
+                ? quantize(r, 31, bias) << 11 | quantize(g, 63, bias) << 5 | quantize(b, 31, bias)
+                : quantize(r, 31, bias) << 11 | quantize(g, 31, bias) << 6 | quantize(b, 31, bias) << 1 |
+                    (a >= 128 ? 1u : 0u));
+
+            // texel i lands on bytes 2i and 2i + 1, which were read already
+            std::memcpy(&texels[2 * i], &packed, sizeof(packed));
+        }
+    }
+
+    texels.resize(2 * size_t(width) * height);
+}
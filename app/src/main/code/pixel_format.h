@@ -0,0 +1,21 @@
+#ifndef PIXEL_FORMAT_H
+#define PIXEL_FORMAT_H
+
+#include "types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+inline size_t texel_bytes(pixel_format format)
+{
+    return format == pixel_format::rgba8888 ? 4 : 2;
+}
+
+// Packs RGBA texels into format in place, as native-endian 16-bit texels for
+// the 16-bit formats. Colors round to the nearest step, or to a 4x4 Bayer
+// threshold when dithering; alpha is cut at half. Nothing to do for rgba8888.
+void pack_texels(std::vector<uint8_t>& texels, uint32_t width, uint32_t height,
+    pixel_format format, bool dither);
+
+#endif
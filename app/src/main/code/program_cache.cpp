@@ -0,0 +1,139 @@
+#include "program_cache.h"
+
+#include <cstdio>
+#include <fstream>
+
+namespace {
+
+    const uint32_t FILE_MAGIC = 0x4e494250; // "PBIN"
+    const uint32_t FILE_VERSION = 1;
+    const size_t HEADER_SIZE = 4 + 4 + 8 + 4 + 4 + 4;
+
+    // all fields little-endian
+    void put_u32(uint8_t*& p, uint32_t v)
+    {
+        for (size_t i = 0; i < 4; ++i) { *p++ = uint8_t(v >> (8 * i)); }
+    }
+
+    void put_u64(uint8_t*& p, uint64_t v)
+    {
+        for (size_t i = 0; i < 8; ++i) { *p++ = uint8_t(v >> (8 * i)); }
+    }
+
+    uint32_t get_u32(const uint8_t*& p)
+    {
+        uint32_t v = 0;
+        for (size_t i = 0; i < 4; ++i) { v |= uint32_t(*p++) << (8 * i); }
+        return v;
+    }
+
+    uint64_t get_u64(const uint8_t*& p)
+    {
+        uint64_t v = 0;
+        for (size_t i = 0; i < 8; ++i) { v |= uint64_t(*p++) << (8 * i); }
+        return v;
+    }
+
+    // FNV-1a, 64 bits
+    uint64_t hash_bytes(uint64_t hash, const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) { hash = (hash ^ bytes[i]) * 1099511628211ull; }
+        return hash;
+    }
+
+    const uint64_t HASH_SEED = 14695981039346656037ull;
+
+    uint32_t checksum(const std::vector<uint8_t>& binary)
+    {
+        const uint64_t hash = hash_bytes(HASH_SEED, binary.data(), binary.size());
+        return uint32_t(hash ^ (hash >> 32));
+    }
+
+}
+
+program_cache::program_cache(const std::string& directory)
+    : directory_(directory)
+{
+}
+
+uint64_t program_cache::make_key(const std::string& driver, const std::string& vert, const std::string& frag)
+{
+    // the terminating zeros keep "ab" + "c" apart from "a" + "bc"
+    uint64_t hash = hash_bytes(HASH_SEED, driver.c_str(), driver.size() + 1);
+    hash = hash_bytes(hash, vert.c_str(), vert.size() + 1);
+    return hash_bytes(hash, frag.c_str(), frag.size() + 1);
+}
+
+bool program_cache::load(uint64_t key, uint32_t& format, std::vector<uint8_t>& binary) const
+{
+    if (!enabled()) { return false; }
+
+    std::ifstream file { path(key), std::ios::binary | std::ios::ate };
+    if (!file.is_open()) { return false; }
+
+    const std::streamoff length = file.tellg();
+    file.seekg(0);
+
+    uint8_t header[HEADER_SIZE];
+    file.read(reinterpret_cast<char*>(header), HEADER_SIZE);
+    if (file.gcount() != std::streamsize(HEADER_SIZE)) { return false; }
+
+    const uint8_t* p = header;
+    if (get_u32(p) != FILE_MAGIC || get_u32(p) != FILE_VERSION || get_u64(p) != key) { return false; }
+
+    format = get_u32(p);
+    const uint32_t size = get_u32(p);
+    const uint32_t sum = get_u32(p);
+
+    // checked before allocating: a damaged size field could ask for gigabytes
+    if (length != std::streamoff(HEADER_SIZE) + std::streamoff(size)) { return false; }
+
+    binary.resize(size);
+    file.read(reinterpret_cast<char*>(binary.data()), size);
+
+    return file.gcount() == std::streamsize(size) && checksum(binary) == sum;
+}
+
+void program_cache::store(uint64_t key, uint32_t format, const std::vector<uint8_t>& binary) const
+{
+    if (!enabled()) { return; }
+
+    uint8_t header[HEADER_SIZE];
+    uint8_t* p = header;
+    put_u32(p, FILE_MAGIC);
+    put_u32(p, FILE_VERSION);
+    put_u64(p, key);
+    put_u32(p, format);
+    put_u32(p, uint32_t(binary.size()));
+    put_u32(p, checksum(binary));
+
+    // a reader never sees a half-written file
+    const std::string target = path(key);
+    const std::string temp = target + ".tmp";
+
+    {
+        std::ofstream file { temp, std::ios::binary | std::ios::trunc };
+        if (!file.is_open()) { return; }
+
+        file.write(reinterpret_cast<const char*>(header), HEADER_SIZE);
+        file.write(reinterpret_cast<const char*>(binary.data()), binary.size());
+    }
+
+    std::ifstream written { temp, std::ios::binary | std::ios::ate };
+    const bool complete = written.is_open() && written.tellg() == std::streamoff(HEADER_SIZE + binary.size());
+
+    if (!complete || std::rename(temp.c_str(), target.c_str()) != 0) { std::remove(temp.c_str()); }
+}
+
+void program_cache::remove(uint64_t key) const
+{
+    if (enabled()) { std::remove(path(key).c_str()); }
+}
+
+std::string program_cache::path(uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "/program-%016llx.bin", static_cast<unsigned long long>(key));
+    return directory_ + name;
+}
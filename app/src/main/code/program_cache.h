@@ -0,0 +1,36 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Linked program binaries on disk, a file per key. Keys hash the driver
+// strings with the sources, so a driver update or an edited shader misses
+// instead of loading a binary the driver would reject.
+class program_cache final
+{
+public:
+    // an empty directory disables the cache
+    explicit program_cache(const std::string& directory = std::string());
+
+    inline bool enabled() const { return !directory_.empty(); }
+
+    static uint64_t make_key(const std::string& driver, const std::string& vert, const std::string& frag);
+
+    // false when there is no intact binary for the key
+    bool load(uint64_t key, uint32_t& format, std::vector<uint8_t>& binary) const;
+
+    // best effort: a failed write only costs a compile on the next start
+    void store(uint64_t key, uint32_t format, const std::vector<uint8_t>& binary) const;
+
+    // for a binary the driver refused, e.g. after an update that kept its strings
+    void remove(uint64_t key) const;
+
+private:
+    std::string directory_;
+
+    std::string path(uint64_t key) const;
+};
+
+#endif
@@ -1,23 +1,92 @@
 #include "renderer.h"
 
+#include "affine.h"
 #include "asset_loader.h"
 #include "bundle.h"
-#include "mat3.h"
-#include "rect.h"
+#include "frame_arena.h"
+#include "mip_chain.h"
+#include "pixel_format.h"
+#include "program_cache.h"
+#include "sprite_batch.h"
+#include "texture_streamer.h"
 #include "vec2.h"
 
 #include <android/native_window.h>
 
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
 
 namespace {
 
     const GLuint ATTRIBUTE_POSITION = 0;
     const GLuint ATTRIBUTE_TEXCOORD = 1;
+    const GLuint ATTRIBUTE_PAGE = 2;
+    const GLuint ATTRIBUTE_LAYER = 3;
 
     const char* UNIFORM_MATRIX = "Matrix";
     const char* UNIFORM_TEXTURE = "Texture";
+    const char* UNIFORM_LAYER_DEPTH = "LayerDepth";
+
+    // a run's pages are bound to the first units, Texture[i] samples unit i
+    const GLint PAGE_UNITS[MAX_BATCH_PAGES] = { 0, 1, 2, 3 };
+
+    // sprites drawn between depth clears, each gets its own depth
+    const uint32_t MAX_LAYERS = 4096;
+    const float LAYER_DEPTH = 2.0f / (MAX_LAYERS + 1);
+
+    // full-height opaque quads remembered to tell if the screen is covered
+    const size_t MAX_COVER_SPANS = 8;
+
+    // counts the fragments each pixel gets: every layer adds a little red
+    const char* OVERDRAW_VERT =
+        "uniform mat3 Matrix;\n"
+        "uniform float LayerDepth;\n"
+        "attribute vec2 transform;\n"
+        "attribute float layer;\n"
+        "void main()\n"
+        "{\n"
+        "    gl_Position = vec4((Matrix * vec3(transform, 1)).xy, 1.0 - (layer + 1.0) * LayerDepth, 1);\n"
+        "}\n";
+
+    const char* OVERDRAW_FRAG =
+        "precision mediump float;\n"
+        "void main()\n"
+        "{\n"
+        "    gl_FragColor = vec4(0.125, 0.03125, 0.0, 1.0);\n"
+        "}\n";
+
+    // copies the offscreen target to the window, one texel per pixel block
+    const char* UPSCALE_VERT =
+        "attribute vec2 transform;\n"
+        "varying vec2 uv;\n"
+        "void main()\n"
+        "{\n"
+        "    uv = transform * 0.5 + 0.5;\n"
+        "    gl_Position = vec4(transform, 0, 1);\n"
+        "}\n";
+
+    const char* UPSCALE_FRAG =
+        "precision mediump float;\n"
+        "uniform sampler2D Texture;\n"
+        "varying vec2 uv;\n"
+        "void main()\n"
+        "{\n"
+        "    gl_FragColor = texture2D(Texture, uv);\n"
+        "}\n";
+
+    const GLfloat FULL_SCREEN_STRIP[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+
+    // vertex and index buffers of the sprite batch plus transient game data
+    const size_t FRAME_ARENA_SIZE = 128 * 1024;
+
+    // default limit of resident texture memory, also what the tier choice aims for
+    const size_t TEXTURE_BUDGET = 32 * 1024 * 1024;
 
     using blend_func = void (*)();
 
@@ -30,28 +99,66 @@ namespace {
             glEnable(GL_BLEND);
             glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         }
-    };
 
-    struct vertex
-    {
-        vec2 position;
-        vec2 texcoord;
+        static void additive()
+        {
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+        }
     };
 
     struct material_unit
     {
         blend_func apply_blend;
+        // drawn in the front-to-back pass with depth writes
+        bool opaque;
         GLint matrix_uniform;
         GLint texture_uniform;
+        GLint layer_depth_uniform;
         size_t program;
         size_t texture;
+        size_t batch_key;
     };
 
-    struct texture_unit
+    struct span
+    {
+        float left;
+        float right;
+    };
+
+    // GL_OES_get_program_binary, null where the driver does not have it
+    struct program_binary_functions
+    {
+        PFNGLGETPROGRAMBINARYOESPROC get = nullptr;
+        PFNGLPROGRAMBINARYOESPROC load = nullptr;
+    };
+
+    // sources stay in memory, so a lost context can be rebuilt without
+    // touching the assets again
+    struct program_unit
     {
         GLuint handle;
+        std::string vert;
+        std::string frag;
+    };
+
+    // Pages become resident on the first draw that uses them and leave under
+    // memory pressure. Decoded texels are kept once a page has loaded, so an
+    // evicted page, or any page after a lost context, only costs an upload.
+    struct texture_unit
+    {
+        GLuint handle; // 0 while not resident
+        bool pending;
+        size_t bytes;
+        uint64_t last_used;
+        // level 0 first, more than one path means a mip chain
+        std::vector<std::string> paths;
+        pixel_format format;
+        bool dither;
+        // packed levels of the last load, empty until then
         uint32_t width;
         uint32_t height;
+        std::vector<std::vector<uint8_t>> levels;
     };
 
     GLuint create_shader(GLenum type, const char* source)
@@ -76,6 +183,120 @@ namespace {
         throw std::runtime_error(&info[0]);
     }
 
+    GLuint create_program(const std::string& vert, const std::string& frag)
+    {
+        GLuint vshader = create_shader(GL_VERTEX_SHADER, vert.c_str());
+        GLuint fshader = create_shader(GL_FRAGMENT_SHADER, frag.c_str());
+
+        GLuint program = glCreateProgram();
+        if (program == 0) { throw std::runtime_error("can not create program"); }
+
+        glBindAttribLocation(program, ATTRIBUTE_POSITION, "transform");
+        glBindAttribLocation(program, ATTRIBUTE_TEXCOORD, "texcoord");
+        glBindAttribLocation(program, ATTRIBUTE_PAGE, "page");
+        glBindAttribLocation(program, ATTRIBUTE_LAYER, "layer");
+
+        glAttachShader(program, vshader);
+        glAttachShader(program, fshader);
+        glLinkProgram(program);
+
+        glDeleteShader(vshader);
+        glDeleteShader(fshader);
+
+        GLint linkStatus = GL_TRUE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+        if (linkStatus != GL_TRUE)
+        {
+            GLint len;
+            glGetProgramiv(program, GL_INFO_LOG_LENGTH, &len);
+
+            std::vector<char> info(static_cast<size_t>(len) + 1);
+            glGetProgramInfoLog(program, len, &len, &info[0]);
+
+            glDeleteProgram(program);
+
+            throw std::runtime_error(&info[0]);
+        }
+
+        return program;
+    }
+
+    // returns the bytes the levels take in GL memory
+    size_t upload_texture(GLuint handle, uint32_t width, uint32_t height, pixel_format format,
+        const std::vector<std::vector<uint8_t>>& levels)
+    {
+        GLenum gl_format = GL_RGBA, gl_type = GL_UNSIGNED_BYTE;
+        if (format == pixel_format::rgb565) { gl_format = GL_RGB; gl_type = GL_UNSIGNED_SHORT_5_6_5; }
+        if (format == pixel_format::rgba5551) { gl_type = GL_UNSIGNED_SHORT_5_5_5_1; }
+
+        glBindTexture(GL_TEXTURE_2D, handle);
+
+        // rows of 16-bit texels are only 2-aligned at odd widths, e.g. small mip levels
+        glPixelStorei(GL_UNPACK_ALIGNMENT, GLint(texel_bytes(format)));
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels.size() > 1 ? GL_LINEAR_MIPMAP_NEAREST : GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        size_t bytes = 0;
+        for (size_t level = 0; level < levels.size(); ++level)
+        {
+            glTexImage2D(GL_TEXTURE_2D, level, gl_format, mip_size(width, level), mip_size(height, level),
+                0, gl_format, gl_type, &levels[level][0]);
+            bytes += levels[level].size();
+        }
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return bytes;
+    }
+
+    size_t tier_bytes(const texture_source& texture, const texture_tier& tier)
+    {
+        const size_t bytes = texel_bytes(texture.format) *
+            (texture.width / tier.divisor) * (texture.height / tier.divisor);
+        return tier.levels.size() > 1 ? bytes + bytes / 3 : bytes;
+    }
+
+    // the finest tier not finer than divisor; the full resolution one is always there
+    const texture_tier& find_tier(const texture_source& texture, uint32_t divisor)
+    {
+        auto it = texture.tiers.rbegin();
+        while (it->divisor > divisor) { ++it; }
+        return *it;
+    }
+
+    // The coarsest divisor whose texels are still no larger than a screen
+    // pixel, then coarser ones while all pages together exceed the budget.
+    // Sprite UVs are normalized, so any tier maps to the same rects.
+    uint32_t choose_divisor(const bundle& b, int32_t window_width)
+    {
+        std::vector<uint32_t> divisors;
+        for (auto& texture: b.textures())
+        {
+            for (auto& tier: texture.tiers) { divisors.push_back(tier.divisor); }
+        }
+
+        std::sort(divisors.begin(), divisors.end());
+        divisors.erase(std::unique(divisors.begin(), divisors.end()), divisors.end());
+
+        auto total_bytes = [&](uint32_t divisor)
+        {
+            size_t bytes = 0;
+            for (auto& texture: b.textures()) { bytes += tier_bytes(texture, find_tier(texture, divisor)); }
+            return bytes;
+        };
+
+        // full resolution pages have a texel per screen-width unit
+        const float texels_per_pixel = b.value("screen-width") / std::max(window_width, 1);
+
+        size_t i = 0;
+        while (i + 1 < divisors.size() && divisors[i + 1] <= texels_per_pixel) { ++i; }
+        while (i + 1 < divisors.size() && total_bytes(divisors[i]) > TEXTURE_BUDGET) { ++i; }
+
+        return divisors.empty() ? 1 : divisors[i];
+    }
+
 }
 
 class renderer::impl
@@ -84,56 +305,133 @@ public:
     explicit impl(ANativeWindow* w);
     ~impl();
 
+    bool attach_window(ANativeWindow* w);
+    void detach_window();
+    inline bool has_window() const { return surface_ != EGL_NO_SURFACE; }
+
+    inline void set_program_cache(const std::string& directory) { program_cache_ = program_cache(directory); }
+    inline program_build_stats& program_stats() { return program_stats_; }
+
     void add_program(std::string vert, std::string frag);
-    void add_texture(std::vector<uint8_t> bytes);
+    void add_texture(const std::vector<std::string>& paths, pixel_format format, bool dither);
     void add_material(const material_source& source);
+    void start_streaming(const asset_loader& loader);
+
+    void reload_program(size_t index, const std::string& vert, const std::string& frag);
+    void reload_texture(const std::string& path, const asset_loader& loader);
 
     void begin_frame();
     void end_frame();
 
     void set_screen_width(float width);
+    inline void set_overdraw_view(bool enabled) { overdraw_view_ = enabled; }
+    inline void set_render_width(int32_t width) { render_width_ = width; }
 
-    void draw(const sprite& s, const mat3& matrix);
+    template <typename Placement>
+    void draw(const sprite* const* sprites, const Placement* placements, size_t count);
+    void draw(const batch_vertex* quads, size_t count, size_t material, vec2 offset);
+
+    inline frame_arena& arena() { return arena_; }
+    inline size_t clamped_vertices() const { return batch_.clamped_vertices(); }
+    inline int32_t window_width() const { return ANativeWindow_getWidth(window_); }
+
+    inline void set_texture_budget(size_t bytes) { texture_budget_ = bytes; }
+    texture_residency residency() const;
 
 private:
-    ANativeWindow* window_;
+    ANativeWindow* window_ = nullptr;
+    EGLConfig config_ = nullptr;
     EGLDisplay display_ = EGL_NO_DISPLAY;
     EGLSurface surface_ = EGL_NO_SURFACE;
     EGLContext context_ = EGL_NO_CONTEXT;
 
-    std::vector<GLuint> programs_;
+    std::vector<program_unit> programs_;
+    program_cache program_cache_;
+    program_binary_functions binary_;
+    // vendor, renderer and version, part of every cache key
+    std::string driver_;
+    program_build_stats program_stats_ = {};
     std::vector<texture_unit> textures_;
     std::vector<material_unit> materials_;
 
-    mat3 view_matrix_;
+    std::unique_ptr<texture_streamer> streamer_;
+    std::vector<decoded_texture> decoded_;
+    // drawn in blended runs while a page is loading
+    GLuint placeholder_ = 0;
+    size_t texture_budget_ = TEXTURE_BUDGET;
+    size_t resident_bytes_ = 0;
+    size_t uploads_ = 0;
+    size_t evictions_ = 0;
+    uint64_t frame_ = 0;
+
+    affine view_matrix_;
     vec2 view_size_;
 
-    struct {
-        size_t material;
-        std::vector<vertex> vertices;
-        std::vector<uint16_t> indices;
-    } batch_;
-
+    frame_arena arena_;
+    sprite_batch batch_;
+
+    // the first flush of a frame clears, color only when opaque quads leave gaps
+    bool target_cleared_ = false;
+    span cover_spans_[MAX_COVER_SPANS];
+    size_t cover_span_count_ = 0;
+
+    bool overdraw_view_ = false;
+    GLuint overdraw_program_ = 0;
+    GLint overdraw_matrix_uniform_ = -1;
+    GLint overdraw_layer_depth_uniform_ = -1;
+
+    // Offscreen target the frame is drawn into when render_width_ is below
+    // the window width, upscaled to the window with nearest filtering in
+    // end_frame. Recreated when the size changes.
+    int32_t render_width_ = 0;
+    bool target_failed_ = false;
+    bool target_bound_ = false;
+    GLuint target_framebuffer_ = 0;
+    GLuint target_texture_ = 0;
+    GLuint target_depth_ = 0;
+    int32_t target_width_ = 0;
+    int32_t target_height_ = 0;
+    GLuint upscale_program_ = 0;
+    GLint upscale_texture_uniform_ = -1;
+
+    void create_context();
+    void init_program_binaries();
+    GLuint build_program(const std::string& vert, const std::string& frag);
+    GLuint load_program_binary(uint64_t key);
+    void store_program_binary(uint64_t key, GLuint program);
+    void rebuild_context();
+    void restore_resources();
     void clear_resources();
-    void use_material(size_t m);
-    uint16_t push_vertex(vec2 p, vec2 t);
-    void push_triangle(uint16_t i1, uint16_t i2, uint16_t i3);
+    void update_uniforms(material_unit& material);
+    void create_placeholder();
+    GLuint use_texture(size_t index);
+    bool will_draw(size_t material) const;
+    void make_resident(texture_unit& unit);
+    void upload_decoded();
+    void evict_for(size_t bytes);
+    void create_overdraw_program();
+    void create_upscale_program();
+    bool bind_target(int32_t width, int32_t height);
+    void delete_target();
+    void present_target(int32_t window_width, int32_t window_height);
+    void add_cover(const sprite& s, const affine& m);
+    inline void add_cover(const sprite& s, vec2 p) { add_cover(s, affine_translation(p.x, p.y)); }
+    bool screen_covered() const;
+    void clear_target();
+    void set_batch_material(size_t material);
+    void draw_run(const batch_run& run);
     void flush_batch();
 };
 
 renderer::impl::impl(ANativeWindow* w)
-    : window_(w)
+    : arena_(FRAME_ARENA_SIZE)
 {
     const EGLint attribs[] = {
         EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
         EGL_RED_SIZE, 8,
         EGL_GREEN_SIZE, 8,
         EGL_BLUE_SIZE, 8,
-        EGL_NONE
-    };
-
-    EGLint contextAttrib[] = {
-        EGL_CONTEXT_CLIENT_VERSION, 2,
+        EGL_DEPTH_SIZE, 16,
         EGL_NONE
     };
 
@@ -141,38 +439,170 @@ renderer::impl::impl(ANativeWindow* w)
     eglInitialize(display_, 0, 0);
 
     EGLint numConfigs;
-    EGLConfig config;
-    eglChooseConfig(display_, attribs, &config, 1, &numConfigs);
+    eglChooseConfig(display_, attribs, &config_, 1, &numConfigs);
+
+    create_context();
+    attach_window(w);
+    init_program_binaries();
+    create_placeholder();
+    create_overdraw_program();
+    create_upscale_program();
+}
+
+renderer::impl::~impl()
+{
+    if (display_ == EGL_NO_DISPLAY) { return; }
+
+    // destroying the context releases its objects when none is current
+    if (has_window()) { clear_resources(); }
+
+    eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+    if (context_ != EGL_NO_CONTEXT) { eglDestroyContext(display_, context_); }
+    if (surface_ != EGL_NO_SURFACE) { eglDestroySurface(display_, surface_); }
+
+    eglTerminate(display_);
+}
+
+bool renderer::impl::attach_window(ANativeWindow* w)
+{
+    window_ = w;
 
     EGLint format;
-    eglGetConfigAttrib(display_, config, EGL_NATIVE_VISUAL_ID, &format);
+    eglGetConfigAttrib(display_, config_, EGL_NATIVE_VISUAL_ID, &format);
     ANativeWindow_setBuffersGeometry(window_, 0, 0, format);
 
-    surface_ = eglCreateWindowSurface(display_, config, window_, nullptr);
-    context_ = eglCreateContext(display_, config, nullptr, contextAttrib);
+    surface_ = eglCreateWindowSurface(display_, config_, window_, nullptr);
 
+    bool kept = true;
     if (eglMakeCurrent(display_, surface_, surface_, context_) == EGL_FALSE)
     {
-        return; // throw
+        // the context was lost while we had no window
+        rebuild_context();
+        kept = false;
     }
 
     eglSwapInterval(display_, 1);
 
     glDisable(GL_CULL_FACE);
+
+    return kept;
 }
 
-renderer::impl::~impl()
+void renderer::impl::detach_window()
 {
-    clear_resources();
+    eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroySurface(display_, surface_);
 
-    if (display_ == EGL_NO_DISPLAY) { return; }
+    surface_ = EGL_NO_SURFACE;
+    window_ = nullptr;
+}
 
-    eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+void renderer::impl::create_context()
+{
+    const EGLint attribs[] = {
+        EGL_CONTEXT_CLIENT_VERSION, 2,
+        EGL_NONE
+    };
 
-    if (context_ != EGL_NO_CONTEXT) { eglDestroyContext(display_, context_); }
-    if (surface_ != EGL_NO_SURFACE) { eglDestroySurface(display_, surface_); }
+    context_ = eglCreateContext(display_, config_, nullptr, attribs);
+}
 
-    eglTerminate(display_);
+// recreates programs from the sources kept in memory; pages are streamed
+// from the assets again when next drawn
+void renderer::impl::rebuild_context()
+{
+    eglDestroyContext(display_, context_);
+    create_context();
+    eglMakeCurrent(display_, surface_, surface_, context_);
+    init_program_binaries();
+    restore_resources();
+}
+
+void renderer::impl::init_program_binaries()
+{
+    binary_ = program_binary_functions();
+
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    if (extensions == nullptr || std::strstr(extensions, "GL_OES_get_program_binary") == nullptr) { return; }
+
+    // the extension may be listed with no format to save in
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats);
+    if (formats == 0) { return; }
+
+    binary_.get = reinterpret_cast<PFNGLGETPROGRAMBINARYOESPROC>(eglGetProcAddress("glGetProgramBinaryOES"));
+    binary_.load = reinterpret_cast<PFNGLPROGRAMBINARYOESPROC>(eglGetProcAddress("glProgramBinaryOES"));
+    if (binary_.get == nullptr || binary_.load == nullptr) { binary_ = program_binary_functions(); }
+
+    driver_.clear();
+    for (GLenum name: { GL_VENDOR, GL_RENDERER, GL_VERSION })
+    {
+        const char* value = reinterpret_cast<const char*>(glGetString(name));
+        driver_ += value != nullptr ? value : "";
+        driver_ += '\n';
+    }
+}
+
+// loads the linked binary when the cache has it, otherwise compiles and
+// links the sources and saves the binary for the next start
+GLuint renderer::impl::build_program(const std::string& vert, const std::string& frag)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    const bool cacheable = binary_.get != nullptr && program_cache_.enabled();
+    const uint64_t key = cacheable ? program_cache::make_key(driver_, vert, frag) : 0;
+
+    GLuint program = cacheable ? load_program_binary(key) : 0;
+    if (program != 0)
+    {
+        ++program_stats_.cached;
+    }
+    else
+    {
+        program = create_program(vert, frag);
+        ++program_stats_.compiled;
+        if (cacheable) { store_program_binary(key, program); }
+    }
+
+    program_stats_.micros += std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    return program;
+}
+
+GLuint renderer::impl::load_program_binary(uint64_t key)
+{
+    uint32_t format;
+    std::vector<uint8_t> binary;
+    if (!program_cache_.load(key, format, binary)) { return 0; }
+
+    const GLuint program = glCreateProgram();
+    binary_.load(program, format, binary.data(), static_cast<GLint>(binary.size()));
+
+    GLint linkStatus = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+    if (linkStatus == GL_TRUE) { return program; }
+
+    // rejected, e.g. by a driver update that kept its strings
+    glDeleteProgram(program);
+    program_cache_.remove(key);
+    return 0;
+}
+
+void renderer::impl::store_program_binary(uint64_t key, GLuint program)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+    if (length <= 0) { return; }
+
+    std::vector<uint8_t> binary(static_cast<size_t>(length));
+    GLenum format = 0;
+    GLsizei written = 0;
+    binary_.get(program, length, &written, &format, binary.data());
+    if (written <= 0) { return; }
+
+    binary.resize(static_cast<size_t>(written));
+    program_cache_.store(key, format, binary);
 }
 
 void renderer::impl::begin_frame()
@@ -180,191 +610,543 @@ void renderer::impl::begin_frame()
     int32_t w = ANativeWindow_getWidth(window_);
     int32_t h = ANativeWindow_getHeight(window_);
 
+    target_bound_ = false;
+    if (render_width_ > 0 && render_width_ < w && !target_failed_)
+    {
+        // same aspect as the window, rounded to whole pixels
+        const int32_t target_height = std::max<int32_t>(1, (2 * render_width_ * h + w) / (2 * w));
+        target_bound_ = bind_target(render_width_, target_height);
+    }
+
+    if (target_bound_)
+    {
+        w = target_width_;
+        h = target_height_;
+    }
+    else
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
     glViewport(0, 0, w, h);
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
+    target_cleared_ = false;
+    cover_span_count_ = 0;
 
     view_size_ = vec2 { static_cast<float>(w), static_cast<float>(h) };
-    view_matrix_ = mat3_scaling(2.0f / w, 2.0f / h);
-    batch_.vertices.clear();
-    batch_.indices.clear();
+    view_matrix_ = affine_scaling(2.0f / w, 2.0f / h);
+
+    ++frame_;
+    evict_for(0);
+    upload_decoded();
+
+    arena_.reset();
+    batch_.begin(arena_);
 }
 
 void renderer::impl::end_frame()
 {
     flush_batch();
-    eglSwapBuffers(display_, surface_);
+
+    if (target_bound_) { present_target(ANativeWindow_getWidth(window_), ANativeWindow_getHeight(window_)); }
+
+    if (eglSwapBuffers(display_, surface_) == EGL_FALSE && eglGetError() == EGL_CONTEXT_LOST)
+    {
+        rebuild_context();
+    }
 }
 
 void renderer::impl::set_screen_width(float width)
 {
-    view_matrix_ = mat3_scaling(2.0f / width, 2.0f * view_size_.x / (view_size_.y * width));
+    view_matrix_ = affine_scaling(2.0f / width, 2.0f * view_size_.x / (view_size_.y * width));
 }
 
-void renderer::impl::draw(const sprite& s, const mat3& m)
+void renderer::impl::set_batch_material(size_t material)
 {
-    use_material(s.material);
-    const auto& texture = textures_[materials_[s.material].texture];
+    if (material < materials_.size())
+    {
+        const material_unit& unit = materials_[material];
+        batch_.set_material(material, unit.batch_key, static_cast<uint32_t>(unit.texture));
+    }
+    else
+    {
+        // nothing is drawn before load_assets
+        batch_.set_material(material, material, 0);
+    }
+}
 
-    const auto center = vec2 { s.rect.left, s.rect.bottom } + s.origin;
-    const auto rect = s.rect - center;
+// Placement is an affine or a translation. Materials are looked up only
+// when they change, consecutive sprites mostly share one.
+template <typename Placement>
+void renderer::impl::draw(const sprite* const* sprites, const Placement* placements, size_t count)
+{
+    if (count == 0) { return; }
 
-    const vec2 vcs[] = {
-        m * vec2 { rect.left, rect.bottom },
-        m * vec2 { rect.left, rect.top },
-        m * vec2 { rect.right, rect.bottom },
-        m * vec2 { rect.right, rect.top }
-    };
+    size_t material = sprites[0]->material;
+    set_batch_material(material);
 
-    const struct rect uv {
-        s.rect.left / texture.width,
-        s.rect.right / texture.width,
-        s.rect.bottom / texture.height,
-        s.rect.top / texture.height
-    };
+    for (size_t i = 0; i < count; ++i)
+    {
+        const sprite& s = *sprites[i];
+        if (s.material != material)
+        {
+            material = s.material;
+            set_batch_material(material);
+        }
 
-    const uint16_t ics[] = {
-        push_vertex(vcs[0], vec2 { uv.left, uv.bottom }),
-        push_vertex(vcs[1], vec2 { uv.left, uv.top }),
-        push_vertex(vcs[2], vec2 { uv.right, uv.bottom }),
-        push_vertex(vcs[3], vec2 { uv.right, uv.top })
-    };
+        if (!batch_.add(s, placements[i]))
+        {
+            flush_batch();
+            batch_.add(s, placements[i]);
+        }
 
-    push_triangle(ics[0], ics[1], ics[3]);
-    push_triangle(ics[0], ics[3], ics[2]);
+        if (!target_cleared_ && material < materials_.size() && materials_[material].opaque && will_draw(material))
+        {
+            add_cover(s, placements[i]);
+        }
+    }
 }
 
-void renderer::impl::use_material(size_t m)
+void renderer::impl::draw(const batch_vertex* quads, size_t count, size_t material, vec2 offset)
 {
-    if (batch_.material != m)
+    set_batch_material(material);
+
+    while (true)
     {
+        const size_t added = batch_.add_quads(quads, count, offset);
+        if (added == count) { break; }
+
         flush_batch();
-        batch_.material = m;
+        quads += 4 * added;
+        count -= added;
     }
 }
 
-uint16_t renderer::impl::push_vertex(vec2 p, vec2 t)
+// remembers axis-aligned quads that span the whole screen height
+void renderer::impl::add_cover(const sprite& s, const affine& m)
 {
-    batch_.vertices.emplace_back(vertex { p, t });
-    return static_cast<uint16_t>(batch_.vertices.size() - 1);
+    if (m.m[1] != 0.0f || m.m[2] != 0.0f || cover_span_count_ == MAX_COVER_SPANS) { return; }
+
+    const vec2 center = vec2 { s.rect.left, s.rect.bottom } + s.origin;
+    const vec2 a = m * (vec2 { s.rect.left, s.rect.bottom } - center);
+    const vec2 b = m * (vec2 { s.rect.right, s.rect.top } - center);
+
+    const float half_height = 1.0f / view_matrix_.m[3];
+    if (std::min(a.y, b.y) > -half_height || std::max(a.y, b.y) < half_height) { return; }
+
+    cover_spans_[cover_span_count_++] = span { std::min(a.x, b.x), std::max(a.x, b.x) };
 }
 
-void renderer::impl::push_triangle(uint16_t i1, uint16_t i2, uint16_t i3)
+bool renderer::impl::screen_covered() const
 {
-    batch_.indices.insert(batch_.indices.end(), { i1, i2, i3 });
+    const float half_width = 1.0f / view_matrix_.m[0];
+    float covered = -half_width;
+
+    // a handful of spans: sweep left to right, extending the covered prefix
+    for (bool extended = true; extended && covered < half_width;)
+    {
+        extended = false;
+        for (size_t i = 0; i < cover_span_count_; ++i)
+        {
+            if (cover_spans_[i].left <= covered && cover_spans_[i].right > covered)
+            {
+                covered = cover_spans_[i].right;
+                extended = true;
+            }
+        }
+    }
+
+    return covered >= half_width;
 }
 
-void renderer::impl::flush_batch()
+void renderer::impl::clear_target()
 {
-    if (batch_.indices.empty() || materials_.empty()) { return; }
+    target_cleared_ = true;
 
-    const auto& material = materials_[batch_.material];
+    // depth writes also gate clearing the depth buffer
+    glDepthMask(GL_TRUE);
+    glClearDepthf(1.0f);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 
-    material.apply_blend();
+    const bool keep_color = !overdraw_view_ && screen_covered();
+    glClear(keep_color ? GL_DEPTH_BUFFER_BIT : GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
 
-    glUseProgram(programs_[material.program]);
+void renderer::impl::draw_run(const batch_run& run)
+{
+    const auto& material = materials_[run.material];
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textures_[material.texture].handle);
-    glUniform1i(material.texture_uniform, 0);
+    // vertex positions are in fixed-point steps
+    float view_matrix[9];
+    affine_to_mat3(affine_scaling(1.0f / POSITION_SCALE, 1.0f / POSITION_SCALE) * view_matrix_, view_matrix);
 
-    glUniformMatrix3fv(material.matrix_uniform, 1, GL_FALSE, view_matrix_.m);
+    if (overdraw_view_)
+    {
+        blend_applicators::additive();
+        glUseProgram(overdraw_program_);
+        glUniformMatrix3fv(overdraw_matrix_uniform_, 1, GL_FALSE, view_matrix);
+        glUniform1f(overdraw_layer_depth_uniform_, LAYER_DEPTH);
+    }
+    else
+    {
+        // uploads go to unit 0, which every run leaves active
+        GLuint handles[MAX_BATCH_PAGES];
+        bool loading = false;
+        for (uint32_t p = 0; p < run.page_count; ++p)
+        {
+            handles[p] = use_texture(run.pages[p]);
+            loading |= handles[p] == 0;
+        }
+
+        // the transparent placeholder would show black in an opaque run and
+        // hide what is behind it
+        if (loading && material.opaque) { return; }
+
+        material.apply_blend();
+        glUseProgram(programs_[material.program].handle);
+
+        for (uint32_t p = run.page_count; p-- > 0;)
+        {
+            glActiveTexture(GL_TEXTURE0 + p);
+            glBindTexture(GL_TEXTURE_2D, handles[p] != 0 ? handles[p] : placeholder_);
+        }
+        glUniform1iv(material.texture_uniform, static_cast<GLsizei>(run.page_count), PAGE_UNITS);
+        glUniformMatrix3fv(material.matrix_uniform, 1, GL_FALSE, view_matrix);
+        glUniform1f(material.layer_depth_uniform, LAYER_DEPTH);
+    }
+
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(run.index_count),
+        GL_UNSIGNED_SHORT, (const void*)(batch_.indices() + run.first_index));
+}
+
+// Opaque runs go front to back with depth writes, so covered pixels are
+// rejected before shading: runs last to first, each with its triangles
+// reversed. Blended runs follow back to front and are only depth tested.
+// Later sprites have smaller depths, inside a run as well.
+void renderer::impl::flush_batch()
+{
+    if (batch_.empty() || materials_.empty()) { return; }
+
+    if (!target_cleared_) { clear_target(); }
 
     glVertexAttribPointer(ATTRIBUTE_POSITION, 2,
-        GL_FLOAT, GL_FALSE, sizeof(vertex),
-        (const void*)&batch_.vertices[0].position
+        GL_SHORT, GL_FALSE, sizeof(batch_vertex),
+        (const void*)batch_.vertices()[0].position
     );
     glEnableVertexAttribArray(ATTRIBUTE_POSITION);
 
     glVertexAttribPointer(ATTRIBUTE_TEXCOORD, 2,
-        GL_FLOAT, GL_FALSE, sizeof(vertex),
-        (const void*)&batch_.vertices[0].texcoord
+        GL_SHORT, GL_FALSE, sizeof(batch_vertex),
+        (const void*)batch_.vertices()[0].texcoord
     );
     glEnableVertexAttribArray(ATTRIBUTE_TEXCOORD);
 
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(batch_.indices.size()),
-        GL_UNSIGNED_SHORT, (const void*)&batch_.indices[0]);
+    glVertexAttribPointer(ATTRIBUTE_PAGE, 1,
+        GL_UNSIGNED_SHORT, GL_FALSE, sizeof(batch_vertex),
+        (const void*)&batch_.vertices()[0].page
+    );
+    glEnableVertexAttribArray(ATTRIBUTE_PAGE);
+
+    glVertexAttribPointer(ATTRIBUTE_LAYER, 1,
+        GL_UNSIGNED_SHORT, GL_FALSE, sizeof(batch_vertex),
+        (const void*)&batch_.vertices()[0].layer
+    );
+    glEnableVertexAttribArray(ATTRIBUTE_LAYER);
+
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+
+    const batch_run* runs = batch_.runs();
+
+    glDepthMask(GL_TRUE);
+    for (size_t i = batch_.run_count(); i-- > 0;)
+    {
+        if (!materials_[runs[i].material].opaque) { continue; }
+
+        batch_.reverse_run(i);
+        draw_run(runs[i]);
+    }
+
+    glDepthMask(GL_FALSE);
+    for (size_t i = 0; i < batch_.run_count(); ++i)
+    {
+        if (!materials_[runs[i].material].opaque) { draw_run(runs[i]); }
+    }
 
     glDisableVertexAttribArray(0);
     glDisableVertexAttribArray(1);
     glDisableVertexAttribArray(2);
+    glDisableVertexAttribArray(3);
+
+    batch_.clear();
+
+    // the next batch could run out of layers: start over on a fresh depth buffer
+    if (batch_.layer_count() > MAX_LAYERS - sprite_batch::MAX_SPRITES)
+    {
+        glDepthMask(GL_TRUE);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        batch_.reset_layers();
+    }
+}
+
+void renderer::impl::create_overdraw_program()
+{
+    overdraw_program_ = build_program(OVERDRAW_VERT, OVERDRAW_FRAG);
+    overdraw_matrix_uniform_ = glGetUniformLocation(overdraw_program_, UNIFORM_MATRIX);
+    overdraw_layer_depth_uniform_ = glGetUniformLocation(overdraw_program_, UNIFORM_LAYER_DEPTH);
+}
+
+void renderer::impl::create_upscale_program()
+{
+    upscale_program_ = build_program(UPSCALE_VERT, UPSCALE_FRAG);
+    upscale_texture_uniform_ = glGetUniformLocation(upscale_program_, UNIFORM_TEXTURE);
+}
+
+// binds the offscreen target, creating it at this size first; false when
+// the driver can not render to it, the window is used from then on
+bool renderer::impl::bind_target(int32_t width, int32_t height)
+{
+    if (target_framebuffer_ != 0 && target_width_ == width && target_height_ == height)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, target_framebuffer_);
+        return true;
+    }
+
+    delete_target();
+    target_width_ = width;
+    target_height_ = height;
+
+    glGenTextures(1, &target_texture_);
+    glBindTexture(GL_TEXTURE_2D, target_texture_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-    batch_.indices.clear();
-    batch_.vertices.clear();
+    glGenRenderbuffers(1, &target_depth_);
+    glBindRenderbuffer(GL_RENDERBUFFER, target_depth_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &target_framebuffer_);
+    glBindFramebuffer(GL_FRAMEBUFFER, target_framebuffer_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target_texture_, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, target_depth_);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE) { return true; }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    delete_target();
+    target_failed_ = true;
+    return false;
+}
+
+void renderer::impl::delete_target()
+{
+    glDeleteFramebuffers(1, &target_framebuffer_);
+    glDeleteRenderbuffers(1, &target_depth_);
+    glDeleteTextures(1, &target_texture_);
+
+    target_framebuffer_ = 0;
+    target_depth_ = 0;
+    target_texture_ = 0;
+    target_width_ = 0;
+    target_height_ = 0;
+}
+
+void renderer::impl::present_target(int32_t window_width, int32_t window_height)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, window_width, window_height);
+
+    // every pixel is written below; the clear tells tiled GPUs not to load
+    // the previous contents
+    glDepthMask(GL_TRUE);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glUseProgram(upscale_program_);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, target_texture_);
+    glUniform1i(upscale_texture_uniform_, 0);
+
+    glVertexAttribPointer(ATTRIBUTE_POSITION, 2, GL_FLOAT, GL_FALSE, 0, FULL_SCREEN_STRIP);
+    glEnableVertexAttribArray(ATTRIBUTE_POSITION);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glDisableVertexAttribArray(ATTRIBUTE_POSITION);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 void renderer::impl::add_program(std::string vert, std::string frag)
 {
-    GLuint vshader = create_shader(GL_VERTEX_SHADER, vert.c_str());
-    if (vshader == 0) { return; }
+    const GLuint handle = build_program(vert, frag);
+    programs_.emplace_back(program_unit { handle, std::move(vert), std::move(frag) });
+}
 
-    GLuint fshader = create_shader(GL_FRAGMENT_SHADER, frag.c_str());
-    if (fshader == 0) { return; }
+void renderer::impl::reload_program(size_t index, const std::string& vert, const std::string& frag)
+{
+    program_unit& unit = programs_[index];
+    const GLuint handle = build_program(vert, frag);
 
-    GLuint program = glCreateProgram();
-    if (program == 0) { return; } // throw
+    glDeleteProgram(unit.handle);
+    unit = program_unit { handle, vert, frag };
 
-    glBindAttribLocation(program, ATTRIBUTE_POSITION, "transform");
-    glBindAttribLocation(program, ATTRIBUTE_TEXCOORD, "texcoord");
+    for (auto& material: materials_)
+    {
+        if (material.program == index) { update_uniforms(material); }
+    }
+}
 
-    glAttachShader(program, vshader);
-    glAttachShader(program, fshader);
-    glLinkProgram(program);
+void renderer::impl::add_texture(const std::vector<std::string>& paths, pixel_format format, bool dither)
+{
+    textures_.emplace_back(texture_unit { 0, false, 0, 0, paths, format, dither, 0, 0, {} });
+}
 
-    GLint linkStatus = GL_TRUE;
-    glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
-    if (linkStatus != GL_TRUE)
+void renderer::impl::start_streaming(const asset_loader& loader)
+{
+    streamer_.reset(new texture_streamer(loader));
+}
+
+void renderer::impl::reload_texture(const std::string& path, const asset_loader& loader)
+{
+    for (size_t index = 0; index < textures_.size(); ++index)
     {
-        GLint len;
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &len);
+        texture_unit& unit = textures_[index];
 
-        std::vector<char> info(static_cast<size_t>(len) + 1);
-        glGetProgramInfoLog(program, len, &len, &info[0]);
+        // a page that never loaded reads the changed file when it is loaded first
+        if (unit.levels.empty()) { continue; }
+        if (std::find(unit.paths.begin(), unit.paths.end(), path) == unit.paths.end()) { continue; }
 
-        glDeleteProgram(program);
+        decoded_texture page = decode_texture(loader, index, unit.paths, unit.format, unit.dither);
+        if (!page.error.empty()) { throw std::runtime_error(page.error); }
 
-        throw std::runtime_error(&info[0]);
+        unit.width = page.width;
+        unit.height = page.height;
+        unit.levels = std::move(page.levels);
+
+        if (unit.handle == 0) { continue; }
+
+        resident_bytes_ -= unit.bytes;
+        unit.bytes = upload_texture(unit.handle, unit.width, unit.height, unit.format, unit.levels);
+        resident_bytes_ += unit.bytes;
     }
+}
+
+// the page, uploaded from kept texels when needed; 0 while it is loading
+GLuint renderer::impl::use_texture(size_t index)
+{
+    texture_unit& unit = textures_[index];
+    unit.last_used = frame_;
+
+    if (unit.handle != 0) { return unit.handle; }
+
+    if (!unit.levels.empty())
+    {
+        make_resident(unit);
+        return unit.handle;
+    }
+
+    if (!unit.pending && streamer_ != nullptr)
+    {
+        unit.pending = true;
+        streamer_->request(index, unit.paths, unit.format, unit.dither);
+    }
+
+    return 0;
+}
 
-    programs_.push_back(program);
+// whether the material's page is drawn this frame rather than skipped as loading
+bool renderer::impl::will_draw(size_t material) const
+{
+    const texture_unit& unit = textures_[materials_[material].texture];
+    return unit.handle != 0 || !unit.levels.empty();
 }
 
-void renderer::impl::add_texture(std::vector<uint8_t> bytes)
+void renderer::impl::make_resident(texture_unit& unit)
 {
-    static const uint32_t BMP_WIDTH_OFFSET = 18;
-    static const uint32_t BMP_HEIGHT_OFFSET = 22;
-    static const uint32_t BMP_DATA_OFFSET = 54;
-    static const uint32_t CHANNELS_COUNT = 4;
+    size_t bytes = 0;
+    for (auto& level: unit.levels) { bytes += level.size(); }
+    evict_for(bytes);
+
+    glGenTextures(1, &unit.handle);
+    unit.bytes = upload_texture(unit.handle, unit.width, unit.height, unit.format, unit.levels);
+    resident_bytes_ += unit.bytes;
+    ++uploads_;
+}
 
-    texture_unit unit;
-    unit.width = *reinterpret_cast<const uint32_t*>(&bytes[BMP_WIDTH_OFFSET]);
-    unit.height = *reinterpret_cast<const uint32_t*>(&bytes[BMP_HEIGHT_OFFSET]);
+void renderer::impl::upload_decoded()
+{
+    if (streamer_ == nullptr) { return; }
 
-    std::vector<uint8_t> texels(CHANNELS_COUNT * unit.width * unit.height);
+    decoded_.clear();
+    streamer_->collect(decoded_);
 
-    const uint32_t data_size = 3 * unit.width * unit.height;
-    for (uint32_t i = 0, t = 0; i < data_size; i += 3, t += CHANNELS_COUNT)
+    for (auto& page: decoded_)
     {
-        uint8_t r = texels[t] = bytes[BMP_DATA_OFFSET + i + 2];
-        uint8_t g = texels[t + 1] = bytes[BMP_DATA_OFFSET + i + 1];
-        uint8_t b = texels[t + 2] = bytes[BMP_DATA_OFFSET + i];
+        if (!page.error.empty()) { throw std::runtime_error(page.error); }
 
-        texels[t + 3] = (uint8_t)((r == 0xff && g == 0x00 && b == 0xff) ? 0x00 : 0xff);
+        texture_unit& unit = textures_[page.texture];
+        unit.pending = false;
+        unit.width = page.width;
+        unit.height = page.height;
+        unit.levels = std::move(page.levels);
+
+        if (unit.handle == 0) { make_resident(unit); }
     }
+}
 
-    glGenTextures(1, &unit.handle);
-    glBindTexture(GL_TEXTURE_2D, unit.handle);
+// Drops least recently drawn pages from GPU memory until `bytes` more fit
+// the budget; their texels stay. Pages drawn in the last frame are never
+// dropped, the budget gives way instead.
+void renderer::impl::evict_for(size_t bytes)
+{
+    while (resident_bytes_ + bytes > texture_budget_)
+    {
+        texture_unit* oldest = nullptr;
+        for (auto& unit: textures_)
+        {
+            if (unit.handle == 0 || unit.last_used + 1 >= frame_) { continue; }
+            if (oldest == nullptr || unit.last_used < oldest->last_used) { oldest = &unit; }
+        }
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        if (oldest == nullptr) { return; }
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, unit.width, unit.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &texels[0]);
+        glDeleteTextures(1, &oldest->handle);
+        oldest->handle = 0;
+        resident_bytes_ -= oldest->bytes;
+        oldest->bytes = 0;
+        ++evictions_;
+    }
+}
 
-    glBindTexture(GL_TEXTURE_2D, 0);
+void renderer::impl::create_placeholder()
+{
+    const std::vector<std::vector<uint8_t>> transparent { { 0, 0, 0, 0 } };
 
-    textures_.emplace_back(unit);
+    glGenTextures(1, &placeholder_);
+    upload_texture(placeholder_, 1, 1, pixel_format::rgba8888, transparent);
+}
+
+texture_residency renderer::impl::residency() const
+{
+    texture_residency r = {};
+    r.bytes = resident_bytes_;
+    r.budget = texture_budget_;
+    r.uploads = uploads_;
+    r.evictions = evictions_;
+
+    for (auto& unit: textures_)
+    {
+        if (unit.handle != 0) { ++r.resident; }
+        if (unit.pending) { ++r.pending; }
+        for (auto& level: unit.levels) { r.kept_bytes += level.size(); }
+    }
+
+    return r;
 }
 
 void renderer::impl::add_material(const material_source& source)
@@ -372,26 +1154,81 @@ void renderer::impl::add_material(const material_source& source)
     material_unit unit;
     unit.texture = source.texture;
     unit.program = source.shader;
-    unit.matrix_uniform = glGetUniformLocation(programs_[source.shader], UNIFORM_MATRIX);
-    unit.texture_uniform = glGetUniformLocation(programs_[source.shader], UNIFORM_TEXTURE);
+    unit.batch_key = source.batch_key;
+    update_uniforms(unit);
 
     switch (source.blend)
     {
-        case blend_mode::none: unit.apply_blend = blend_applicators::none;
-        case blend_mode::alpha: unit.apply_blend = blend_applicators::alpha;
+        case blend_mode::none:
+            unit.apply_blend = blend_applicators::none;
+            unit.opaque = true;
+            break;
+
+        case blend_mode::alpha:
+            unit.apply_blend = blend_applicators::alpha;
+            unit.opaque = false;
+            break;
     }
 
     materials_.emplace_back(unit);
 }
 
+void renderer::impl::update_uniforms(material_unit& material)
+{
+    const GLuint program = programs_[material.program].handle;
+    material.matrix_uniform = glGetUniformLocation(program, UNIFORM_MATRIX);
+    material.texture_uniform = glGetUniformLocation(program, UNIFORM_TEXTURE);
+    material.layer_depth_uniform = glGetUniformLocation(program, UNIFORM_LAYER_DEPTH);
+}
+
+void renderer::impl::restore_resources()
+{
+    program_stats_ = program_build_stats();
+    for (auto& program: programs_) { program.handle = build_program(program.vert, program.frag); }
+    for (auto& material: materials_) { update_uniforms(material); }
+
+    // pages come back from their kept texels as they are drawn, without
+    // reading assets; loads in flight still land
+    for (auto& texture: textures_)
+    {
+        texture.handle = 0;
+        texture.bytes = 0;
+    }
+    resident_bytes_ = 0;
+
+    // names of the lost context, the target is created again on the next frame
+    target_framebuffer_ = 0;
+    target_depth_ = 0;
+    target_texture_ = 0;
+    target_width_ = 0;
+    target_height_ = 0;
+
+    create_placeholder();
+    create_overdraw_program();
+    create_upscale_program();
+}
+
 void renderer::impl::clear_resources()
 {
     materials_.clear();
 
-    for (auto texture: textures_) { glDeleteTextures(1, &texture.handle); };
+    streamer_.reset();
+
+    for (auto& texture: textures_) { glDeleteTextures(1, &texture.handle); };
     textures_.clear();
+    resident_bytes_ = 0;
+
+    glDeleteTextures(1, &placeholder_);
+    placeholder_ = 0;
 
-    for (GLuint program: programs_) { glDeleteProgram(program); };
+    glDeleteProgram(overdraw_program_);
+    overdraw_program_ = 0;
+
+    delete_target();
+    glDeleteProgram(upscale_program_);
+    upscale_program_ = 0;
+
+    for (auto& program: programs_) { glDeleteProgram(program.handle); };
     programs_.clear();
 }
 
@@ -400,6 +1237,21 @@ renderer::renderer(ANativeWindow* w): impl_(new impl(w)) {}
 
 renderer::~renderer() {}
 
+bool renderer::attach_window(ANativeWindow* w)
+{
+    return impl_->attach_window(w);
+}
+
+void renderer::detach_window()
+{
+    impl_->detach_window();
+}
+
+bool renderer::has_window() const
+{
+    return impl_->has_window();
+}
+
 void renderer::load_assets(const bundle& b, const asset_loader& loader)
 {
     for (auto& shader: b.shaders())
@@ -407,17 +1259,53 @@ void renderer::load_assets(const bundle& b, const asset_loader& loader)
         impl_->add_program(loader.load_string(shader.vert), loader.load_string(shader.frag));
     }
 
+    const uint32_t divisor = choose_divisor(b, impl_->window_width());
+
+    impl_->program_stats() = program_build_stats();
+
     for (auto& texture: b.textures())
     {
-        impl_->add_texture(loader.load_bytes(texture.path));
+        impl_->add_texture(find_tier(texture, divisor).levels, texture.format, texture.dither);
     }
 
+    impl_->start_streaming(loader);
+
     for (auto& material: b.materials())
     {
         impl_->add_material(material);
     }
 }
 
+void renderer::set_program_cache(const std::string& directory)
+{
+    impl_->set_program_cache(directory);
+}
+
+program_build_stats renderer::program_stats() const
+{
+    return impl_->program_stats();
+}
+
+void renderer::set_texture_budget(size_t bytes)
+{
+    impl_->set_texture_budget(bytes);
+}
+
+texture_residency renderer::residency() const
+{
+    return impl_->residency();
+}
+
+void renderer::reload_shader(size_t shader, const std::string& vert, const std::string& frag)
+{
+    impl_->reload_program(shader, vert, frag);
+}
+
+void renderer::reload_texture(const std::string& path, const asset_loader& loader)
+{
+    impl_->reload_texture(path, loader);
+}
+
 void renderer::begin_frame(float interpolation, int64_t delta)
 {
     frame_interpolation_ = interpolation;
@@ -435,17 +1323,54 @@ void renderer::set_screen_width(float width)
     impl_->set_screen_width(width);
 }
 
-void renderer::draw(const sprite& s, const mat3& matrix)
+void renderer::set_overdraw_view(bool enabled)
+{
+    impl_->set_overdraw_view(enabled);
+}
+
+void renderer::set_render_width(int32_t width)
 {
-    impl_->draw(s, matrix);
+    impl_->set_render_width(width);
+}
+
+void renderer::draw(const sprite& s, const affine& matrix)
+{
+    const sprite* sprites[] = { &s };
+    impl_->draw(sprites, &matrix, 1);
 }
 
 void renderer::draw(const sprite& s, vec2 position)
 {
-    impl_->draw(s, mat3_translation(position.x, position.y));
+    const sprite* sprites[] = { &s };
+    impl_->draw(sprites, &position, 1);
 }
 
 void renderer::draw(const sprite& s)
 {
-    impl_->draw(s, mat3_translation(0.0f, 0.0f));
+    draw(s, vec2 { 0.0f, 0.0f });
+}
+
+void renderer::draw(const sprite* const* sprites, const vec2* positions, size_t count)
+{
+    impl_->draw(sprites, positions, count);
+}
+
+void renderer::draw(const sprite* const* sprites, const affine* matrices, size_t count)
+{
+    impl_->draw(sprites, matrices, count);
+}
+
+void renderer::draw(const batch_vertex* quads, size_t count, size_t material, vec2 offset)
+{
+    impl_->draw(quads, count, material, offset);
+}
+
+frame_arena& renderer::transient_arena()
+{
+    return impl_->arena();
+}
+
+size_t renderer::clamped_vertices() const
+{
+    return impl_->clamped_vertices();
 }
@@ -5,30 +5,101 @@
 
 #include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 
 struct ANativeWindow;
 
 class asset_loader;
+struct batch_vertex;
 class bundle;
+class frame_arena;
 struct sprite;
 
+struct texture_residency
+{
+    size_t resident;
+    size_t pending;
+    // of resident pages, mip levels included
+    size_t bytes;
+    size_t budget;
+    // decoded texels in memory, for uploads after eviction or a lost context
+    size_t kept_bytes;
+    // since the renderer was created
+    size_t uploads;
+    size_t evictions;
+};
+
+// how the programs of the last load_assets or context rebuild were made
+struct program_build_stats
+{
+    size_t cached;
+    size_t compiled;
+    int64_t micros;
+};
+
 class renderer final
 {
 public:
     explicit renderer(ANativeWindow* w);
     ~renderer();
 
+    // the GL context and resources outlive the window; attach_window returns
+    // false when the context was lost and had to be rebuilt
+    bool attach_window(ANativeWindow* w);
+    void detach_window();
+    bool has_window() const;
+
+    // linked programs are saved to and loaded from this directory when the
+    // driver supports GL_OES_get_program_binary; set before load_assets
+    void set_program_cache(const std::string& directory);
+    program_build_stats program_stats() const;
+
+    // texture pages are only loaded when first drawn, see texture_residency
     void load_assets(const bundle& b, const asset_loader& loader);
 
+    // least recently drawn pages leave GPU memory above this many bytes
+    void set_texture_budget(size_t bytes);
+    texture_residency residency() const;
+
+    // replace resources in place, keeping their indices and GL names
+    void reload_shader(size_t shader, const std::string& vert, const std::string& frag);
+    // reloads the tier of every resident page that reads path, mip levels included
+    void reload_texture(const std::string& path, const asset_loader& loader);
+
     void begin_frame(float interpolation, int64_t delta);
     void end_frame();
 
     void set_screen_width(float width);
 
-    void draw(const sprite& s, const mat3& matrix);
+    // replaces shading with additive layer counting, brighter where more
+    // fragments survive the depth test
+    void set_overdraw_view(bool enabled);
+
+    // Draws frames this many pixels wide, at the window's aspect, and
+    // upscales them to the window. 0, or at least the window width, draws
+    // to the window directly.
+    void set_render_width(int32_t width);
+
+    void draw(const sprite& s, const affine& matrix);
     void draw(const sprite& s, vec2 position);
     void draw(const sprite& s);
 
+    // sprites[i] at positions[i], or with matrices[i], for count sprites in
+    // one call; what per-frame loops over views should use
+    void draw(const sprite* const* sprites, const vec2* positions, size_t count);
+    void draw(const sprite* const* sprites, const affine* matrices, size_t count);
+
+    // quads of four vertices prepared by the caller, all of one material
+    void draw(const batch_vertex* quads, size_t count, size_t material, vec2 offset);
+
+    // memory for data that only lives until the end of the frame
+    frame_arena& transient_arena();
+
+    // vertices drawn clamped because they fell outside the fixed-point range
+    // of batch_vertex, since the renderer was created
+    size_t clamped_vertices() const;
+
     inline float frame_interpolation() const { return frame_interpolation_; }
     inline int64_t frame_delta() const { return frame_delta_; }
 
@@ -0,0 +1,166 @@
+#include "renderer.h"
+
+#include "affine.h"
+#include "frame_arena.h"
+#include "sprite.h"
+#include "sprite_batch.h"
+
+// Renderer for host builds without a display: builds the same batches as
+// the GL renderer and discards them on flush.
+
+namespace {
+
+    const size_t FRAME_ARENA_SIZE = 128 * 1024;
+
+}
+
+class renderer::impl
+{
+public:
+    impl() : arena_(FRAME_ARENA_SIZE) {}
+
+    void begin_frame()
+    {
+        arena_.reset();
+        batch_.begin(arena_);
+    }
+
+    void end_frame() { flush_batch(); }
+
+    // no materials are loaded, so each is its own batch key
+    template <typename Placement>
+    void draw(const sprite* const* sprites, const Placement* placements, size_t count)
+    {
+        if (count == 0) { return; }
+
+        size_t material = sprites[0]->material;
+        batch_.set_material(material, material, 0);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const sprite& s = *sprites[i];
+            if (s.material != material)
+            {
+                material = s.material;
+                batch_.set_material(material, material, 0);
+            }
+
+            if (!batch_.add(s, placements[i]))
+            {
+                flush_batch();
+                batch_.add(s, placements[i]);
+            }
+        }
+    }
+
+    void draw(const batch_vertex* quads, size_t count, size_t material, vec2 offset)
+    {
+        batch_.set_material(material, material, 0);
+
+        while (true)
+        {
+            const size_t added = batch_.add_quads(quads, count, offset);
+            if (added == count) { break; }
+
+            flush_batch();
+            quads += 4 * added;
+            count -= added;
+        }
+    }
+
+    inline frame_arena& arena() { return arena_; }
+    inline size_t clamped_vertices() const { return batch_.clamped_vertices(); }
+
+private:
+    frame_arena arena_;
+    sprite_batch batch_;
+
+    void flush_batch()
+    {
+        batch_.clear();
+    }
+};
+
+renderer::renderer(ANativeWindow*): impl_(new impl()) {}
+
+renderer::~renderer() {}
+
+bool renderer::attach_window(ANativeWindow*) { return true; }
+
+void renderer::detach_window() {}
+
+bool renderer::has_window() const { return true; }
+
+void renderer::load_assets(const bundle&, const asset_loader&) {}
+
+void renderer::set_program_cache(const std::string&) {}
+
+program_build_stats renderer::program_stats() const { return program_build_stats(); }
+
+void renderer::set_texture_budget(size_t) {}
+
+texture_residency renderer::residency() const { return texture_residency(); }
+
+void renderer::reload_shader(size_t, const std::string&, const std::string&) {}
+
+void renderer::reload_texture(const std::string&, const asset_loader&) {}
+
+void renderer::begin_frame(float interpolation, int64_t delta)
+{
+    frame_interpolation_ = interpolation;
+    frame_delta_ = delta;
+    impl_->begin_frame();
+}
+
+void renderer::end_frame()
+{
+    impl_->end_frame();
+}
+
+void renderer::set_screen_width(float) {}
+
+void renderer::set_overdraw_view(bool) {}
+
+void renderer::set_render_width(int32_t) {}
+
+void renderer::draw(const sprite& s, const affine& matrix)
+{
+    const sprite* sprites[] = { &s };
+    impl_->draw(sprites, &matrix, 1);
+}
+
+void renderer::draw(const sprite& s, vec2 position)
+{
+    const sprite* sprites[] = { &s };
+    impl_->draw(sprites, &position, 1);
+}
+
+void renderer::draw(const sprite& s)
+{
+    draw(s, vec2 { 0.0f, 0.0f });
+}
+
+void renderer::draw(const sprite* const* sprites, const vec2* positions, size_t count)
+{
+    impl_->draw(sprites, positions, count);
+}
+
+void renderer::draw(const sprite* const* sprites, const affine* matrices, size_t count)
+{
+    impl_->draw(sprites, matrices, count);
+}
+
+void renderer::draw(const batch_vertex* quads, size_t count, size_t material, vec2 offset)
+{
+    impl_->draw(quads, count, material, offset);
+}
+
+frame_arena& renderer::transient_arena()
+{
+    return impl_->arena();
+}
+
+size_t renderer::clamped_vertices() const
+{
+    return impl_->clamped_vertices();
+}
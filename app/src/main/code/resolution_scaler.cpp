@@ -0,0 +1,81 @@
+#include "resolution_scaler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+    const uint32_t WINDOW_FRAMES = 60;
+    const uint32_t WINDOW_MISSES = 6;
+    // frames on time before trying a finer scale, about 5 s at 60 Hz
+    const uint32_t RAISE_AFTER = 300;
+
+    // step down above this, do not step up above RAISE_HEADROOM
+    const float HOT_HEADROOM = 0.85f;
+    const float RAISE_HEADROOM = 0.7f;
+
+}
+
+void resolution_scaler::set_range(float min_scale, float max_scale, float step)
+{
+    min_scale_ = min_scale;
+    max_scale_ = std::max(min_scale, max_scale);
+    step_ = step;
+    scale_ = max_scale_;
+
+    window_frames_ = 0;
+    window_misses_ = 0;
+    frames_on_time_ = 0;
+}
+
+bool resolution_scaler::update(int64_t interval, float headroom)
+{
+    if (interval <= 0) { return false; }
+
+    // stalls, e.g. resuming or loading, say nothing about fill rate
+    if (interval > 6.0f * period_)
+    {
+        frames_on_time_ = 0;
+        return false;
+    }
+
+    const bool missed = interval > 1.5f * period_;
+    if (missed)
+    {
+        ++window_misses_;
+        frames_on_time_ = 0;
+    }
+    else
+    {
+        ++frames_on_time_;
+    }
+
+    bool changed = false;
+
+    if (++window_frames_ == WINDOW_FRAMES)
+    {
+        const bool hot = !std::isnan(headroom) && headroom > HOT_HEADROOM;
+        if (window_misses_ >= WINDOW_MISSES || hot) { changed = step_by(-step_); }
+
+        window_frames_ = 0;
+        window_misses_ = 0;
+    }
+
+    if (frames_on_time_ >= RAISE_AFTER)
+    {
+        frames_on_time_ = 0;
+        if (std::isnan(headroom) || headroom < RAISE_HEADROOM) { changed = step_by(step_) || changed; }
+    }
+
+    return changed;
+}
+
+bool resolution_scaler::step_by(float delta)
+{
+    const float scale = std::min(std::max(scale_ + delta, min_scale_), max_scale_);
+    if (scale == scale_) { return false; }
+
+    scale_ = scale;
+    frames_on_time_ = 0;
+    return true;
+}
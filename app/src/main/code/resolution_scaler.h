@@ -0,0 +1,41 @@
+#ifndef RESOLUTION_SCALER_H
+#define RESOLUTION_SCALER_H
+
+#include <cstdint>
+
+// Chooses how many pixels the game is rendered at per screen-width unit.
+// A frame interval over 1.5 display periods is a miss. Several misses in a
+// short window step the scale down, and so does running close to thermal
+// throttling. A long run of frames on time steps it back up while the
+// device has headroom.
+class resolution_scaler final
+{
+public:
+    // starts at max_scale; steps are of `step`, both ends included
+    void set_range(float min_scale, float max_scale, float step);
+    // the display's refresh period in milliseconds, 60 Hz until set
+    inline void set_display_period(float period) { period_ = period; }
+    inline float scale() const { return scale_; }
+
+    // interval since the previous frame in milliseconds; headroom as from
+    // AThermal_getThermalHeadroom, 1 at throttling, NaN when unknown.
+    // True when the scale changed.
+    bool update(int64_t interval, float headroom);
+
+private:
+    float min_scale_ = 1.0f;
+    float max_scale_ = 1.0f;
+    float step_ = 1.0f;
+    float scale_ = 1.0f;
+
+    // from the platform: estimates from frame intervals, which are whole
+    // milliseconds, get pinned low by catch-up frames after a hitch
+    float period_ = 1000.0f / 60.0f;
+    uint32_t window_frames_ = 0;
+    uint32_t window_misses_ = 0;
+    uint32_t frames_on_time_ = 0;
+
+    bool step_by(float delta);
+};
+
+#endif
@@ -0,0 +1,325 @@
+#include "simulation.h"
+
+#include "bundle.h"
+#include "collision.h"
+#include "rect.h"
+#include "vec2.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable<simulation_state>::value, "snapshots are plain copies");
+static_assert(MAX_SPANS <= 32, "changed_spans has a bit per span");
+
+namespace {
+
+    inline constexpr float lerp(float v1, float v2, float t)
+    {
+        return t * v2 + (1.0f - t) * v1;
+    }
+
+    // uniform in [0, 1]
+    inline float random_unit(uint32_t& state)
+    {
+        return (next_random(state) >> 8) * (1.0f / 16777215.0f);
+    }
+
+    // spans cover the screen right of the character plus the two that scroll
+    // out on the left before they are recycled
+    size_t span_count(const bundle& b)
+    {
+        const float span_width = b.value("span-width");
+        const float visible = 0.5f * b.value("screen-width") + 2.0f * span_width;
+        const size_t count = static_cast<size_t>(std::ceil(visible / span_width));
+
+        if (count > MAX_SPANS) { throw std::runtime_error("screen-width needs more than MAX_SPANS spans"); }
+        return count;
+    }
+
+}
+
+simulation::simulation(const bundle& b)
+{
+    settings_.span_count = span_count(b);
+    apply_settings(b);
+}
+
+void simulation::apply_settings(const bundle& b)
+{
+    settings_.move_velocity = b.value("move-velocity");
+    settings_.back_velocity = b.value("back-velocity");
+    settings_.jump_velocity = b.value("jump-velocity");
+    settings_.jump_angle = b.value("jump-angle");
+    settings_.rotation_speed = b.value("rotation-speed");
+    settings_.gravity = b.value("gravity");
+    settings_.character_x = b.value("character-x");
+    settings_.character_radius = b.value("character-radius");
+    settings_.span_width = b.value("span-width");
+    settings_.tube_width = b.value("tube-width");
+    settings_.bound_inner = b.value("bound-inner");
+    settings_.bound_outer = b.value("bound-outer");
+    settings_.hole_size = b.value("hole-rect_size");
+    settings_.hole_range = b.value("hole-range");
+}
+
+void simulation::reset(simulation_state& s, uint32_t seed) const
+{
+    s = simulation_state();
+    s.random = seed != 0 ? seed : 1;
+    set_phase(s, game_phase::begin);
+}
+
+void simulation::integrate(simulation_state& s, int64_t dt) const
+{
+    s.old.character_y = s.character.y;
+    s.old.character_angle = s.character.angle;
+    s.old.world_x = s.world_x;
+
+    float sec = dt * 0.001f;
+
+    switch (s.game.phase)
+    {
+        case game_phase::begin:
+            move_spans(s, sec, false);
+            break;
+
+        case game_phase::play:
+        {
+            move_spans(s, sec, true);
+            move_character(s, sec);
+            s.character.angle += sec * settings_.rotation_speed;
+
+            float impact;
+            const bool collided = find_impact(s, impact);
+            if (collided)
+            {
+                // stop where the character touched the obstacle, whatever the tick rate
+                s.world_x = lerp(s.old.world_x, s.world_x, impact);
+                s.character.y = lerp(s.old.character_y, s.character.y, impact);
+            }
+
+            s.game.score += collect_points(s);
+
+            if (collided)
+            {
+                s.game.new_best = s.game.score > s.game.best_score;
+                if (s.game.new_best)
+                {
+                    s.game.best_score = s.game.score;
+                }
+
+                set_phase(s, game_phase::end);
+            }
+            break;
+        }
+
+        case game_phase::end:
+            s.game.timer = std::max<int64_t>(s.game.timer - dt, 0);
+            break;
+    }
+}
+
+void simulation::handle_tap(simulation_state& s) const
+{
+    switch (s.game.phase)
+    {
+        case game_phase::begin:
+            set_phase(s, game_phase::play);
+            break;
+
+        case game_phase::play:
+            s.character.velocity = settings_.jump_velocity;
+            s.character.angle = settings_.jump_angle;
+            break;
+
+        case game_phase::end:
+            if (s.game.timer == 0)
+            {
+                set_phase(s, game_phase::begin);
+            }
+            break;
+    }
+}
+
+simulation_state simulation::rollout(const simulation_state& from, size_t ticks, int64_t dt,
+    const uint32_t* tap_ticks, size_t tap_count) const
+{
+    simulation_state s = from;
+    size_t tap = 0;
+
+    for (size_t tick = 0; tick < ticks; ++tick)
+    {
+        for (; tap < tap_count && tap_ticks[tap] <= tick; ++tap) { handle_tap(s); }
+        integrate(s, dt);
+    }
+
+    return s;
+}
+
+size_t simulation::find_span(const simulation_state& s, int64_t offset_x) const
+{
+    if (offset_x < 0) { return settings_.span_count; }
+
+    const size_t i = static_cast<size_t>(offset_x) % settings_.span_count;
+    return s.spans[i].offset_x == offset_x ? i : settings_.span_count;
+}
+
+void simulation::set_phase(simulation_state& s, game_phase phase) const
+{
+    s.game.phase = phase;
+
+    switch (s.game.phase)
+    {
+        case game_phase::begin:
+            s.game.score = 0;
+
+            s.character.y = 0.0f;
+            s.character.velocity = 0.0f;
+            s.character.angle = 0.0f;
+
+            reset_spans(s);
+            break;
+
+        case game_phase::play:
+            s.character.velocity = settings_.jump_velocity;
+            s.character.angle = settings_.jump_angle;
+            break;
+
+        case game_phase::end:
+            s.game.timer = 1000;
+            ++s.game.runs;
+
+            // straight away, not turned back over the interpolated tick
+            s.character.angle = 0.0f;
+            s.old.character_angle = 0.0f;
+            break;
+    }
+}
+
+void simulation::move_spans(simulation_state& s, float sec, bool add_hole) const
+{
+    s.world_x -= settings_.move_velocity * sec;
+
+    for (size_t i = 0; i < settings_.span_count; ++i)
+    {
+        simulation_state::span& sp = s.spans[i];
+        const float span_offset = s.world_x + sp.offset_x * settings_.span_width;
+        if (span_offset > -2.0f * settings_.span_width) { continue; }
+
+        // keeps the span in slot offset_x % count
+        sp.offset_x += settings_.span_count;
+
+        if (add_hole)
+        {
+            sp.points = 1;
+
+            const float arb = settings_.hole_range * (random_unit(s.random) - 0.5f);
+            sp.obstacles[2].collider.top = settings_.bound_outer + arb - (settings_.hole_size * 0.5f);
+            sp.obstacles[3].collider.bottom = -settings_.bound_outer + arb + (settings_.hole_size  * 0.5f);
+        }
+
+        s.changed_spans |= 1u << i;
+    }
+}
+
+void simulation::move_character(simulation_state& s, float sec) const
+{
+    // exact for constant acceleration, so the path does not depend on the tick rate
+    s.character.y += (s.character.velocity + 0.5f * settings_.gravity * sec) * sec;
+    s.character.velocity += settings_.gravity * sec;
+}
+
+uint32_t simulation::collect_points(simulation_state& s) const
+{
+    const float tube_center = settings_.span_width - 0.5f * settings_.tube_width;
+    uint32_t points = 0;
+
+    // tube centers crossed this tick, in world-relative positions
+    const float from = settings_.character_x - s.old.world_x - tube_center;
+    const float to = settings_.character_x - s.world_x - tube_center;
+    const int64_t first = static_cast<int64_t>(std::ceil(from / settings_.span_width));
+    const int64_t last = static_cast<int64_t>(std::ceil(to / settings_.span_width)) - 1;
+
+    for (int64_t offset_x = first; offset_x <= last; ++offset_x)
+    {
+        const size_t i = find_span(s, offset_x);
+        if (i == settings_.span_count) { continue; }
+
+        points += s.spans[i].points;
+        s.spans[i].points = 0;
+    }
+
+    return points;
+}
+
+bool simulation::find_impact(const simulation_state& s, float& toi) const
+{
+    // the character sweeps a straight line relative to the spans during a tick
+    const vec2 from { settings_.character_x - s.old.world_x, s.old.character_y };
+    const vec2 to { settings_.character_x - s.world_x, s.character.y };
+    const vec2 delta = to - from;
+    const float radius = settings_.character_radius;
+
+    // colliders stay inside their span, so only spans under the swept circle count
+    const int64_t first = static_cast<int64_t>(std::floor((std::min(from.x, to.x) - radius) / settings_.span_width));
+    const int64_t last = static_cast<int64_t>(std::floor((std::max(from.x, to.x) + radius) / settings_.span_width));
+
+    bool hit = false;
+    toi = 1.0f;
+
+    for (int64_t offset_x = first; offset_x <= last; ++offset_x)
+    {
+        const size_t span_index = find_span(s, offset_x);
+        if (span_index == settings_.span_count) { continue; }
+
+        const simulation_state::span& sp = s.spans[span_index];
+        const vec2 span_offset { sp.offset_x * settings_.span_width, 0.0f };
+
+        for (size_t i = 0; i < NUM_OBSTACLES_IN_SPAN; ++i)
+        {
+            const simulation_state::obstacle& o = sp.obstacles[i];
+
+            float t;
+            if (sweep_circle_rect(from, delta, radius, o.collider + o.position + span_offset, t) && t < toi)
+            {
+                toi = t;
+                hit = true;
+            }
+        }
+    }
+
+    return hit;
+}
+
+void simulation::reset_spans(simulation_state& s) const
+{
+    s.world_x = -settings_.span_width * 2.0f;
+
+    const float tube_offset = settings_.span_width - settings_.tube_width;
+    const float ground_height = settings_.bound_outer - settings_.bound_inner;
+
+    for (uint32_t i = 0; i < settings_.span_count; ++i)
+    {
+        simulation_state::span& sp = s.spans[i];
+        sp.offset_x = i;
+        sp.points = 0;
+
+        simulation_state::obstacle* obstacles = sp.obstacles;
+
+        obstacles[0].position = { 0.0f, -settings_.bound_outer };
+        obstacles[0].collider = { 0.0f, tube_offset, 0.0f, ground_height };
+
+        obstacles[1].position = { 0.0f, settings_.bound_outer };
+        obstacles[1].collider = { 0.0f, tube_offset, -ground_height, 0.0f };
+
+        obstacles[2].position = { tube_offset, -settings_.bound_outer };
+        obstacles[2].collider = { 0.0f, settings_.tube_width, 0.0f, ground_height };
+
+        obstacles[3].position = { tube_offset, settings_.bound_outer };
+        obstacles[3].collider = { 0.0f, settings_.tube_width, -ground_height, 0.0f };
+
+        s.changed_spans |= 1u << i;
+    }
+}
@@ -0,0 +1,122 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "game_state.h"
+#include "types.h"
+
+#include <cstddef>
+#include <cstdint>
+
+class bundle;
+
+const size_t MAX_SPANS = 16;
+const size_t NUM_OBSTACLES_IN_SPAN = 4;
+
+// xorshift32, the state must not be zero
+inline uint32_t next_random(uint32_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Everything the game rules read and write, as one fixed-size value: a copy
+// is a snapshot. Views, animations and the background live in world.
+struct simulation_state
+{
+    struct obstacle
+    {
+        vec2 position;
+        rect collider;
+    };
+
+    struct span
+    {
+        uint32_t offset_x;
+        uint32_t points;
+        obstacle obstacles[NUM_OBSTACLES_IN_SPAN];
+    };
+
+    game_state game;
+
+    struct {
+        float y;
+        float velocity;
+        float angle;
+    } character;
+
+    // positions at the start of the last tick, for sweeps and interpolation
+    struct {
+        float character_y;
+        float character_angle;
+        float world_x;
+    } old;
+
+    float world_x;
+    uint32_t random;
+    // bit per span whose obstacles changed, cleared by whoever shows them
+    uint32_t changed_spans;
+
+    span spans[MAX_SPANS];
+};
+
+struct simulation_settings
+{
+    float move_velocity;
+    float back_velocity;
+    float jump_velocity;
+    float jump_angle;
+    float rotation_speed;
+    float gravity;
+    float character_x;
+    float character_radius;
+    float span_width;
+    float tube_width;
+    float bound_inner;
+    float bound_outer;
+    float hole_size;
+    float hole_range;
+    size_t span_count;
+};
+
+// The game rules as functions of a simulation_state. The simulation itself
+// only holds tuning values, so one instance can advance any number of states.
+class simulation final
+{
+public:
+    explicit simulation(const bundle& b);
+
+    // re-reads tuning values; the span count stays as it was
+    void apply_settings(const bundle& b);
+
+    inline const simulation_settings& settings() const { return settings_; }
+
+    // a new state in the begin phase
+    void reset(simulation_state& s, uint32_t seed) const;
+
+    void integrate(simulation_state& s, int64_t dt) const;
+    void handle_tap(simulation_state& s) const;
+
+    // advances a copy of `from` by `ticks` ticks of dt, tapping before every
+    // tick listed in tap_ticks (ascending)
+    simulation_state rollout(const simulation_state& from, size_t ticks, int64_t dt,
+        const uint32_t* tap_ticks, size_t tap_count) const;
+
+    // index into spans, span_count when that span is not live
+    size_t find_span(const simulation_state& s, int64_t offset_x) const;
+
+    // swept test of this tick's motion, toi is the fraction of the tick
+    bool find_impact(const simulation_state& s, float& toi) const;
+
+private:
+    simulation_settings settings_;
+
+    void set_phase(simulation_state& s, game_phase phase) const;
+    void move_spans(simulation_state& s, float sec, bool add_hole) const;
+    void move_character(simulation_state& s, float sec) const;
+    uint32_t collect_points(simulation_state& s) const;
+    void reset_spans(simulation_state& s) const;
+};
+
+#endif
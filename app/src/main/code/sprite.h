@@ -2,13 +2,22 @@
 #define SPRITE_H
 
 #include "types.h"
+#include <cstdint>
 #include <cstdlib>
 
+const size_t MAX_OUTLINE_POINTS = 8;
+
 struct sprite
 {
     size_t material;
     struct rect rect;
+    struct rect uv;
     vec2 origin;
+    // convex, counter-clockwise, in fractions of rect; drawn instead of the
+    // full rect when not empty, so transparent corners cost no fill. The
+    // points are stored once, in the bundle the sprite came from.
+    const vec2* outline;
+    uint32_t outline_size;
 };
 
 #endif
@@ -0,0 +1,311 @@
+#include "sprite_batch.h"
+
+#include "affine.h"
+#include "frame_arena.h"
+#include "rect.h"
+#include "sprite.h"
+#include "vec2.h"
+
+#include <algorithm>
+
+#if defined(__aarch64__)
+#define BATCH_NEON 1
+#include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#define BATCH_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+    const size_t VERTICES_PER_SPRITE = 4;
+    const size_t INDICES_PER_SPRITE = 6;
+
+    const size_t MAX_VERTICES = sprite_batch::MAX_SPRITES * VERTICES_PER_SPRITE;
+    const size_t MAX_INDICES = sprite_batch::MAX_SPRITES * INDICES_PER_SPRITE;
+
+    // Converts four vertices at once, positions and texture coordinates each
+    // given as x0 y0 x1 y1 ...; false when anything was clamped. The vector
+    // versions round half to even, which is as good.
+    inline bool pack_quad(const vec2* positions, const vec2* texcoords, uint16_t page, uint16_t layer, batch_vertex* v)
+    {
+#if defined(BATCH_NEON)
+        const float32x4_t low = vdupq_n_f32(INT16_MIN - 0.5f);
+        const float32x4_t high = vdupq_n_f32(INT16_MAX + 0.5f);
+        const float32x4_t p0 = vmulq_n_f32(vld1q_f32(&positions[0].x), POSITION_SCALE);
+        const float32x4_t p1 = vmulq_n_f32(vld1q_f32(&positions[2].x), POSITION_SCALE);
+        const float32x4_t t0 = vmulq_n_f32(vld1q_f32(&texcoords[0].x), TEXCOORD_SCALE);
+        const float32x4_t t1 = vmulq_n_f32(vld1q_f32(&texcoords[2].x), TEXCOORD_SCALE);
+
+        uint32x4_t inside = vandq_u32(vcgtq_f32(p0, low), vcltq_f32(p0, high));
+        inside = vandq_u32(inside, vandq_u32(vcgtq_f32(p1, low), vcltq_f32(p1, high)));
+        inside = vandq_u32(inside, vandq_u32(vcgtq_f32(t0, low), vcltq_f32(t0, high)));
+        inside = vandq_u32(inside, vandq_u32(vcgtq_f32(t1, low), vcltq_f32(t1, high)));
+
+        // conversion and narrowing saturate, clamped values end up at the range ends
+        const int16x8_t p = vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(p0)), vqmovn_s32(vcvtnq_s32_f32(p1)));
+        const int16x8_t t = vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(t0)), vqmovn_s32(vcvtnq_s32_f32(t1)));
+
+        // position, texture coordinates and page with layer interleave as
+        // three words per vertex; the page is the low half on little endian
+        int32x4x3_t vertices;
+        vertices.val[0] = vreinterpretq_s32_s16(p);
+        vertices.val[1] = vreinterpretq_s32_s16(t);
+        vertices.val[2] = vdupq_n_s32(static_cast<int32_t>(page | uint32_t(layer) << 16));
+        vst3q_s32(reinterpret_cast<int32_t*>(v), vertices);
+        return vminvq_u32(inside) != 0;
+#elif defined(BATCH_SSE)
+        const __m128 low = _mm_set1_ps(INT16_MIN - 0.5f);
+        const __m128 high = _mm_set1_ps(INT16_MAX + 0.5f);
+        const __m128 p0 = _mm_mul_ps(_mm_loadu_ps(&positions[0].x), _mm_set1_ps(POSITION_SCALE));
+        const __m128 p1 = _mm_mul_ps(_mm_loadu_ps(&positions[2].x), _mm_set1_ps(POSITION_SCALE));
+        const __m128 t0 = _mm_mul_ps(_mm_loadu_ps(&texcoords[0].x), _mm_set1_ps(TEXCOORD_SCALE));
+        const __m128 t1 = _mm_mul_ps(_mm_loadu_ps(&texcoords[2].x), _mm_set1_ps(TEXCOORD_SCALE));
+
+        __m128 inside = _mm_and_ps(_mm_cmpgt_ps(p0, low), _mm_cmplt_ps(p0, high));
+        inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpgt_ps(p1, low), _mm_cmplt_ps(p1, high)));
+        inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpgt_ps(t0, low), _mm_cmplt_ps(t0, high)));
+        inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpgt_ps(t1, low), _mm_cmplt_ps(t1, high)));
+
+        // packs saturates; out of range conversions give INT32_MIN, which
+        // the mask reports
+        const __m128i p = _mm_packs_epi32(_mm_cvtps_epi32(p0), _mm_cvtps_epi32(p1));
+        const __m128i t = _mm_packs_epi32(_mm_cvtps_epi32(t0), _mm_cvtps_epi32(t1));
+        const __m128i low_pairs = _mm_unpacklo_epi32(p, t);
+        const __m128i high_pairs = _mm_unpackhi_epi32(p, t);
+
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(v), low_pairs);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(v + 1), _mm_srli_si128(low_pairs, 8));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(v + 2), high_pairs);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(v + 3), _mm_srli_si128(high_pairs, 8));
+        for (size_t i = 0; i < VERTICES_PER_SPRITE; ++i)
+        {
+            v[i].page = page;
+            v[i].layer = layer;
+        }
+        return _mm_movemask_ps(inside) == 0xf;
+#else
+        bool fits = true;
+        for (size_t i = 0; i < VERTICES_PER_SPRITE; ++i)
+        {
+            fits &= make_vertex(positions[i], texcoords[i], v[i]);
+            v[i].page = page;
+            v[i].layer = layer;
+        }
+        return fits;
+#endif
+    }
+
+    // fixed-point a + b, clamped to int16
+    inline int16_t add_steps(int16_t a, int16_t b, bool& fits)
+    {
+        const int32_t sum = int32_t(a) + b;
+        if (sum < INT16_MIN || sum > INT16_MAX) { fits = false; }
+        return static_cast<int16_t>(std::min<int32_t>(std::max<int32_t>(sum, INT16_MIN), INT16_MAX));
+    }
+
+}
+
+void sprite_batch::begin(frame_arena& arena)
+{
+    vertices_ = arena.allocate<batch_vertex>(MAX_SPRITES * VERTICES_PER_SPRITE);
+    indices_ = arena.allocate<uint16_t>(MAX_SPRITES * INDICES_PER_SPRITE);
+    // every run has at least one quad
+    runs_ = arena.allocate<batch_run>(MAX_SPRITES);
+    clear();
+    reset_layers();
+}
+
+void sprite_batch::clear()
+{
+    vertex_count_ = 0;
+    index_count_ = 0;
+    sprite_count_ = 0;
+    run_count_ = 0;
+}
+
+bool sprite_batch::add(const sprite& s, const affine& m)
+{
+    const auto center = vec2 { s.rect.left, s.rect.bottom } + s.origin;
+    const auto rect = s.rect - center;
+    const struct rect& uv = s.uv;
+
+    if (s.outline_size != 0)
+    {
+        const size_t points = s.outline_size;
+        if (sprite_count_ == MAX_SPRITES || vertex_count_ + points > MAX_VERTICES ||
+            index_count_ + 3 * (points - 2) > MAX_INDICES)
+        {
+            return false;
+        }
+
+        const vec2 size = rect_size(rect);
+        const vec2 uv_size = rect_size(uv);
+        uint16_t layer;
+        const uint16_t page = start_run(layer);
+
+        batch_vertex* v = vertices_ + vertex_count_;
+        for (size_t i = 0; i < points; ++i)
+        {
+            const vec2 p = s.outline[i];
+            put_vertex(v[i], m * vec2 { rect.left + p.x * size.x, rect.bottom + p.y * size.y },
+                vec2 { uv.left + p.x * uv_size.x, uv.bottom + p.y * uv_size.y }, page, layer);
+        }
+
+        push_fan_indices(points);
+        return true;
+    }
+
+    if (sprite_count_ == MAX_SPRITES || vertex_count_ + VERTICES_PER_SPRITE > MAX_VERTICES ||
+        index_count_ + INDICES_PER_SPRITE > MAX_INDICES)
+    {
+        return false;
+    }
+
+    const vec2 positions[] = {
+        m * vec2 { rect.left, rect.bottom }, m * vec2 { rect.left, rect.top },
+        m * vec2 { rect.right, rect.bottom }, m * vec2 { rect.right, rect.top }
+    };
+    const vec2 texcoords[] = {
+        { uv.left, uv.bottom }, { uv.left, uv.top }, { uv.right, uv.bottom }, { uv.right, uv.top }
+    };
+
+    uint16_t layer;
+    const uint16_t page = start_run(layer);
+    if (!pack_quad(positions, texcoords, page, layer, vertices_ + vertex_count_)) { clamped_vertices_ += VERTICES_PER_SPRITE; }
+
+    push_quad_indices();
+    return true;
+}
+
+bool sprite_batch::add(const sprite& s, vec2 position)
+{
+    if (s.outline_size != 0) { return add(s, affine_translation(position.x, position.y)); }
+
+    if (sprite_count_ == MAX_SPRITES || vertex_count_ + VERTICES_PER_SPRITE > MAX_VERTICES ||
+        index_count_ + INDICES_PER_SPRITE > MAX_INDICES)
+    {
+        return false;
+    }
+
+    const auto center = vec2 { s.rect.left, s.rect.bottom } + s.origin - position;
+    const auto rect = s.rect - center;
+    const struct rect& uv = s.uv;
+
+    const vec2 positions[] = {
+        { rect.left, rect.bottom }, { rect.left, rect.top }, { rect.right, rect.bottom }, { rect.right, rect.top }
+    };
+    const vec2 texcoords[] = {
+        { uv.left, uv.bottom }, { uv.left, uv.top }, { uv.right, uv.bottom }, { uv.right, uv.top }
+    };
+
+    uint16_t layer;
+    const uint16_t page = start_run(layer);
+    if (!pack_quad(positions, texcoords, page, layer, vertices_ + vertex_count_)) { clamped_vertices_ += VERTICES_PER_SPRITE; }
+
+    push_quad_indices();
+    return true;
+}
+
+size_t sprite_batch::add_quads(const batch_vertex* quads, size_t count, vec2 offset)
+{
+    const size_t n = std::min({ count, MAX_SPRITES - sprite_count_,
+        (MAX_VERTICES - vertex_count_) / VERTICES_PER_SPRITE, (MAX_INDICES - index_count_) / INDICES_PER_SPRITE });
+
+    // quads are fixed-point already, the offset is added in steps
+    int16_t step_x, step_y;
+    const bool offset_fits = to_fixed(offset.x, POSITION_SCALE, step_x) & to_fixed(offset.y, POSITION_SCALE, step_y);
+
+    for (size_t q = 0; q < n; ++q)
+    {
+        const batch_vertex* src = quads + q * VERTICES_PER_SPRITE;
+        batch_vertex* dst = vertices_ + vertex_count_;
+        uint16_t layer;
+        const uint16_t page = start_run(layer);
+
+        for (size_t i = 0; i < VERTICES_PER_SPRITE; ++i)
+        {
+            bool fits = offset_fits;
+            dst[i].position[0] = add_steps(src[i].position[0], step_x, fits);
+            dst[i].position[1] = add_steps(src[i].position[1], step_y, fits);
+            dst[i].texcoord[0] = src[i].texcoord[0];
+            dst[i].texcoord[1] = src[i].texcoord[1];
+            dst[i].page = page;
+            dst[i].layer = layer;
+            if (!fits) { ++clamped_vertices_; }
+        }
+
+        push_quad_indices();
+    }
+
+    return n;
+}
+
+void sprite_batch::reverse_run(size_t run)
+{
+    uint16_t* first = indices_ + runs_[run].first_index;
+    uint16_t* last = first + runs_[run].index_count;
+
+    // whole triangles swap places, each keeps its winding
+    while (last - first >= 6)
+    {
+        last -= 3;
+        std::swap_ranges(first, first + 3, last);
+        first += 3;
+    }
+}
+
+uint16_t sprite_batch::start_run(uint16_t& layer)
+{
+    ++sprite_count_;
+    layer = static_cast<uint16_t>(layer_count_++);
+
+    if (run_count_ != 0 && run_key_ == key_)
+    {
+        batch_run& run = runs_[run_count_ - 1];
+        for (uint32_t p = 0; p < run.page_count; ++p)
+        {
+            if (run.pages[p] == texture_) { return static_cast<uint16_t>(p); }
+        }
+
+        if (run.page_count < MAX_BATCH_PAGES)
+        {
+            run.pages[run.page_count] = texture_;
+            return static_cast<uint16_t>(run.page_count++);
+        }
+    }
+
+    run_key_ = key_;
+    runs_[run_count_++] = batch_run { material_, index_count_, 0, 1, { texture_ } };
+    return 0;
+}
+
+void sprite_batch::push_fan_indices(size_t points)
+{
+    const auto base = static_cast<uint16_t>(vertex_count_);
+    uint16_t* i = indices_ + index_count_;
+    for (size_t p = 1; p + 1 < points; ++p)
+    {
+        *i++ = base;
+        *i++ = static_cast<uint16_t>(base + p);
+        *i++ = static_cast<uint16_t>(base + p + 1);
+    }
+
+    const size_t count = 3 * (points - 2);
+    runs_[run_count_ - 1].index_count += count;
+    vertex_count_ += points;
+    index_count_ += count;
+}
+
+void sprite_batch::push_quad_indices()
+{
+    runs_[run_count_ - 1].index_count += INDICES_PER_SPRITE;
+
+    const auto base = static_cast<uint16_t>(vertex_count_);
+    uint16_t* i = indices_ + index_count_;
+    i[0] = base; i[1] = base + 1; i[2] = base + 3;
+    i[3] = base; i[4] = base + 3; i[5] = base + 2;
+
+    vertex_count_ += VERTICES_PER_SPRITE;
+    index_count_ += INDICES_PER_SPRITE;
+}
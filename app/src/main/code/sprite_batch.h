@@ -0,0 +1,150 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include "types.h"
+
+#include <cstddef>
+#include <cstdint>
+
+class frame_arena;
+struct sprite;
+
+// Fixed-point steps of batch vertices. Positions are in 1/32 of a screen
+// unit, so +-1024 units around the view center. Texture coordinates are in
+// 1/8192, exact for integer texel rects on pages up to 8192 texels and
+// +-4 for the ground, which is mapped in world space and repeats.
+const float POSITION_SCALE = 32.0f;
+const float TEXCOORD_SCALE = 8192.0f;
+
+// Texture pages a run draws from, each on its own texture unit. GLES2
+// guarantees 8 units to fragment shaders, sprite.frag chooses among 4.
+const uint32_t MAX_BATCH_PAGES = 4;
+
+// 12 bytes, sprite.vert and the matrix in flush_batch undo the scales
+struct batch_vertex
+{
+    int16_t position[2];
+    int16_t texcoord[2];
+    // index into the run's pages and the sprite's layer, set by the batch
+    uint16_t page;
+    uint16_t layer;
+};
+
+// rounds v * scale to the nearest step; false when that is outside int16
+// and out was clamped to the nearest end
+inline bool to_fixed(float v, float scale, int16_t& out)
+{
+    // biased to be positive, so truncating rounds; lrint would be a libm call
+    // while errno is on
+    const float steps = v * scale + 32768.5f;
+    const float low = steps < 0.5f ? 0.5f : steps;
+    const float clamped = low < 65535.5f ? low : 65535.5f;
+
+    out = static_cast<int16_t>(static_cast<int32_t>(clamped) - 32768);
+    return clamped == steps;
+}
+
+// false when any component was clamped; page and layer are left alone
+inline bool make_vertex(vec2 position, vec2 texcoord, batch_vertex& out)
+{
+    const bool x = to_fixed(position.x, POSITION_SCALE, out.position[0]);
+    const bool y = to_fixed(position.y, POSITION_SCALE, out.position[1]);
+    const bool u = to_fixed(texcoord.x, TEXCOORD_SCALE, out.texcoord[0]);
+    const bool v = to_fixed(texcoord.y, TEXCOORD_SCALE, out.texcoord[1]);
+    return x && y && u && v;
+}
+
+// Consecutive quads of materials with one batch key, from up to
+// MAX_BATCH_PAGES textures.
+struct batch_run
+{
+    // the first material, the others share its program and blend mode
+    size_t material;
+    size_t first_index;
+    size_t index_count;
+    uint32_t page_count;
+    uint32_t pages[MAX_BATCH_PAGES];
+};
+
+// Vertices and indices of the quads since the last flush, stored in the frame
+// arena and split into runs of one batch key each. Layers count sprites in
+// submission order over the whole frame, so a later sprite is always in
+// front of an earlier one, within a run as well.
+class sprite_batch final
+{
+public:
+    static const size_t MAX_SPRITES = 1024;
+
+    // starts the frame and the layer count
+    void begin(frame_arena& arena);
+    // empties the batch; layers keep counting until reset_layers()
+    void clear();
+    inline void reset_layers() { layer_count_ = 0; }
+
+    // material of the quads added from now on and the texture it samples;
+    // materials with the same key share runs
+    inline void set_material(size_t material, size_t key, uint32_t texture)
+    {
+        material_ = material;
+        key_ = key;
+        texture_ = texture;
+    }
+
+    // a quad, or a triangle fan over the sprite's outline; returns false when
+    // the batch is full and has to be flushed first
+    bool add(const sprite& s, const affine& m);
+    // the same for a sprite that is only moved, without the matrix products
+    bool add(const sprite& s, vec2 position);
+
+    // copies prebuilt quads of four vertices each, moved by offset;
+    // returns how many fit
+    size_t add_quads(const batch_vertex* quads, size_t count, vec2 offset);
+
+    // reverses the order of the run's triangles, so its front sprites are
+    // drawn first; a sprite's own triangles do not overlap
+    void reverse_run(size_t run);
+
+    inline bool empty() const { return index_count_ == 0; }
+    inline const batch_vertex* vertices() const { return vertices_; }
+    inline const uint16_t* indices() const { return indices_; }
+    inline size_t vertex_count() const { return vertex_count_; }
+    inline size_t index_count() const { return index_count_; }
+    inline const batch_run* runs() const { return runs_; }
+    inline size_t run_count() const { return run_count_; }
+    inline uint32_t layer_count() const { return layer_count_; }
+
+    // vertices that did not fit the fixed-point range since the batch was
+    // created; they are drawn clamped, so this should stay 0
+    inline size_t clamped_vertices() const { return clamped_vertices_; }
+
+private:
+    batch_vertex* vertices_ = nullptr;
+    uint16_t* indices_ = nullptr;
+    batch_run* runs_ = nullptr;
+    size_t vertex_count_ = 0;
+    size_t index_count_ = 0;
+    size_t sprite_count_ = 0;
+    size_t run_count_ = 0;
+    size_t material_ = 0;
+    size_t key_ = 0;
+    uint32_t texture_ = 0;
+    // of the last run
+    size_t run_key_ = 0;
+    uint32_t layer_count_ = 0;
+    size_t clamped_vertices_ = 0;
+
+    inline void put_vertex(batch_vertex& v, vec2 position, vec2 texcoord, uint16_t page, uint16_t layer)
+    {
+        if (!make_vertex(position, texcoord, v)) { ++clamped_vertices_; }
+        v.page = page;
+        v.layer = layer;
+    }
+
+    // counts a sprite and gives it the next layer, starting a run unless the
+    // last one takes its key and texture; returns the texture's page in the run
+    uint16_t start_run(uint16_t& layer);
+    void push_quad_indices();
+    void push_fan_indices(size_t points);
+};
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef STRING_TABLE_H
+#define STRING_TABLE_H
+
+#include "text_view.h"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// FNV-1a
+inline uint32_t hash_text(text_view text)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < text.size; ++i)
+    {
+        hash = (hash ^ static_cast<uint8_t>(text.data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+// A key with its hash computed once. Keep one around for lookups that repeat,
+// e.g. a static string_key next to the code that asks for it every frame.
+struct string_key
+{
+    text_view text;
+    uint32_t hash;
+
+    inline string_key(text_view t) : text(t), hash(hash_text(t)) {}
+    inline string_key(const char* s) : string_key(text_view(s, std::strlen(s))) {}
+    inline string_key(const std::string& s) : string_key(text_view(s)) {}
+};
+
+// Hash map from names to T with open addressing and linear probing. Slots are
+// 8 bytes, keys are copied into one character arena, values are stored densely
+// in insertion order. Lookups take a view and never allocate.
+template<class T>
+class string_table final
+{
+public:
+    inline size_t size() const { return values_.size(); }
+
+    // nullptr when there is no such key
+    inline T* find(const string_key& key)
+    {
+        const uint32_t index = find_index(key);
+        return index != EMPTY ? &values_[index] : nullptr;
+    }
+
+    inline const T* find(const string_key& key) const
+    {
+        const uint32_t index = find_index(key);
+        return index != EMPTY ? &values_[index] : nullptr;
+    }
+
+    inline const T& at(const string_key& key) const
+    {
+        const uint32_t index = find_index(key);
+        if (index == EMPTY) { throw std::out_of_range("no entry named " + key.text.str()); }
+        return values_[index];
+    }
+
+    // keeps the existing value and returns false when the key is taken
+    inline bool emplace(const string_key& key, T value)
+    {
+        if (find_index(key) != EMPTY) { return false; }
+        insert(key, std::move(value));
+        return true;
+    }
+
+    inline T& operator[](const string_key& key)
+    {
+        const uint32_t index = find_index(key);
+        return index != EMPTY ? values_[index] : insert(key, T());
+    }
+
+private:
+    static const uint32_t EMPTY = UINT32_MAX;
+
+    struct slot
+    {
+        uint32_t hash;
+        uint32_t index; // into values_ and keys_, EMPTY for a free slot
+    };
+
+    struct key_ref
+    {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    std::vector<slot> slots_;
+    std::vector<key_ref> keys_;
+    std::vector<char> chars_;
+    std::vector<T> values_;
+
+    uint32_t find_index(const string_key& key) const
+    {
+        if (slots_.empty()) { return EMPTY; }
+
+        const size_t mask = slots_.size() - 1;
+        for (size_t i = key.hash & mask;; i = (i + 1) & mask)
+        {
+            const slot& s = slots_[i];
+            if (s.index == EMPTY) { return EMPTY; }
+            if (s.hash != key.hash) { continue; }
+
+            const key_ref& k = keys_[s.index];
+            if (k.size == key.text.size && std::memcmp(chars_.data() + k.offset, key.text.data, k.size) == 0)
+            {
+                return s.index;
+            }
+        }
+    }
+
+    T& insert(const string_key& key, T value)
+    {
+        // at most 3/4 full, so probe sequences stay short
+        if ((values_.size() + 1) * 4 > slots_.size() * 3) { rehash(slots_.empty() ? 16 : slots_.size() * 2); }
+
+        const uint32_t index = static_cast<uint32_t>(values_.size());
+        keys_.push_back(key_ref { static_cast<uint32_t>(chars_.size()), static_cast<uint32_t>(key.text.size) });
+        chars_.insert(chars_.end(), key.text.data, key.text.data + key.text.size);
+        values_.emplace_back(std::move(value));
+
+        place(slot { key.hash, index });
+        return values_.back();
+    }
+
+    void rehash(size_t capacity)
+    {
+        std::vector<slot> old(capacity, slot { 0, EMPTY });
+        old.swap(slots_);
+
+        for (const slot& s: old)
+        {
+            if (s.index != EMPTY) { place(s); }
+        }
+    }
+
+    void place(const slot& s)
+    {
+        const size_t mask = slots_.size() - 1;
+        size_t i = s.hash & mask;
+        while (slots_[i].index != EMPTY) { i = (i + 1) & mask; }
+        slots_[i] = s;
+    }
+};
+
+#endif
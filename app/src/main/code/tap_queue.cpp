@@ -0,0 +1,20 @@
+#include "tap_queue.h"
+
+bool tap_queue::push(int64_t time)
+{
+    if (size_ == CAPACITY) { return false; }
+
+    times_[(first_ + size_) % CAPACITY] = time;
+    ++size_;
+    return true;
+}
+
+bool tap_queue::pop_before(int64_t time, int64_t& tap_time)
+{
+    if (size_ == 0 || times_[first_] >= time) { return false; }
+
+    tap_time = times_[first_];
+    first_ = (first_ + 1) % CAPACITY;
+    --size_;
+    return true;
+}
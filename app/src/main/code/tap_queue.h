@@ -0,0 +1,29 @@
+#ifndef TAP_QUEUE_H
+#define TAP_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Taps waiting for the simulation tick they happened in. Times are in
+// app_clock milliseconds and arrive in order.
+class tap_queue final
+{
+public:
+    static const size_t CAPACITY = 32;
+
+    // drops the tap when the queue is full
+    bool push(int64_t time);
+
+    // takes the oldest tap that happened before the given time
+    bool pop_before(int64_t time, int64_t& tap_time);
+
+    inline bool empty() const { return size_ == 0; }
+    inline void clear() { size_ = 0; }
+
+private:
+    int64_t times_[CAPACITY];
+    size_t first_ = 0;
+    size_t size_ = 0;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "text_label.h"
+
+#include "font.h"
+#include "rect.h"
+#include "renderer.h"
+#include "vec2.h"
+
+#include <cstring>
+#include <limits>
+
+namespace {
+
+    const size_t VERTICES_PER_GLYPH = 4;
+
+}
+
+text_label::text_label(const font& f)
+    : font_(f)
+    , align_(0.0f)
+    , offset_(vec2_zero())
+{
+    text_[0] = '\0';
+    vertices_.reserve(MAX_LENGTH * VERTICES_PER_GLYPH);
+}
+
+void text_label::set_align(float a)
+{
+    if (align_ == a) { return; }
+    align_ = a;
+    layout();
+}
+
+void text_label::set_text(const char* text)
+{
+    if (std::strncmp(text_, text, MAX_LENGTH) == 0) { return; }
+
+    std::strncpy(text_, text, MAX_LENGTH);
+    text_[MAX_LENGTH] = '\0';
+    layout();
+}
+
+void text_label::set_number(uint32_t v)
+{
+    char digits[std::numeric_limits<uint32_t>::digits10 + 2];
+    char* p = digits + sizeof(digits) - 1;
+    *p = '\0';
+
+    do
+    {
+        *--p = static_cast<char>('0' + v % 10);
+        v /= 10;
+    }
+    while (v != 0);
+
+    set_text(p);
+}
+
+void text_label::draw(renderer* r) const
+{
+    if (vertices_.empty()) { return; }
+    r->draw(vertices_.data(), vertices_.size() / VERTICES_PER_GLYPH, font_.material(), offset_);
+}
+
+void text_label::layout()
+{
+    vertices_.clear();
+
+    float x = 0.0f;
+    char previous = '\0';
+
+    for (const char* c = text_; *c != '\0'; ++c)
+    {
+        const sprite* g = font_.glyph(*c);
+        if (g == nullptr) { continue; }
+
+        if (previous != '\0') { x += font_.spacing() + font_.kerning(previous, *c); }
+        previous = *c;
+
+        const vec2 size = rect_size(g->rect);
+        const rect r { x - g->origin.x, x - g->origin.x + size.x, -g->origin.y, size.y - g->origin.y };
+
+        const vec2 corners[][2] = {
+            { { r.left, r.bottom }, { g->uv.left, g->uv.bottom } },
+            { { r.left, r.top }, { g->uv.left, g->uv.top } },
+            { { r.right, r.bottom }, { g->uv.right, g->uv.bottom } },
+            { { r.right, r.top }, { g->uv.right, g->uv.top } }
+        };
+
+        for (auto& c: corners)
+        {
+            batch_vertex v;
+            make_vertex(c[0], c[1], v);
+            vertices_.push_back(v);
+        }
+
+        x += size.x;
+    }
+
+    // labels are a few dozen units wide, so the shift always fits
+    int16_t shift;
+    to_fixed(-align_ * x, POSITION_SCALE, shift);
+    for (auto& v: vertices_) { v.position[0] = static_cast<int16_t>(v.position[0] + shift); }
+}
@@ -0,0 +1,41 @@
+#ifndef TEXT_LABEL_H
+#define TEXT_LABEL_H
+
+#include "sprite_batch.h"
+#include "types.h"
+
+#include <cstdint>
+#include <vector>
+
+class font;
+class renderer;
+
+// Text drawn with a bitmap font. Glyph quads are laid out once and kept
+// until the text changes; draw() submits them as one vertex block.
+class text_label final
+{
+public:
+    static const size_t MAX_LENGTH = 32;
+
+    explicit text_label(const font& f);
+
+    void set_align(float a);
+    inline void set_offset(float x, float y) { offset_ = vec2 { x, y }; }
+
+    void set_text(const char* text);
+    void set_number(uint32_t v);
+
+    void draw(renderer* r) const;
+
+private:
+    const font& font_;
+    float align_;
+    vec2 offset_;
+
+    char text_[MAX_LENGTH + 1];
+    std::vector<batch_vertex> vertices_;
+
+    void layout();
+};
+
+#endif
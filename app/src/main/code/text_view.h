@@ -0,0 +1,28 @@
+#ifndef TEXT_VIEW_H
+#define TEXT_VIEW_H
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+// Characters owned by someone else; stands in for std::string_view.
+struct text_view
+{
+    const char* data;
+    size_t size;
+
+    inline text_view() : data(nullptr), size(0) {}
+    inline text_view(const char* d, size_t s) : data(d), size(s) {}
+    inline text_view(const std::string& s) : data(s.data()), size(s.size()) {}
+
+    inline std::string str() const { return std::string(data, size); }
+
+    inline bool operator==(const char* literal) const
+    {
+        return std::strlen(literal) == size && std::memcmp(data, literal, size) == 0;
+    }
+
+    inline bool operator!=(const char* literal) const { return !(*this == literal); }
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "texture_streamer.h"
+
+#include "bmp.h"
+#include "mip_chain.h"
+#include "pixel_format.h"
+
+#include <stdexcept>
+#include <utility>
+
+decoded_texture decode_texture(const asset_loader& loader, size_t texture, const std::vector<std::string>& paths,
+    pixel_format format, bool dither)
+{
+    decoded_texture result;
+    result.texture = texture;
+    result.width = 0;
+    result.height = 0;
+    result.format = format;
+
+    try
+    {
+        result.levels.resize(paths.size());
+
+        for (size_t level = 0; level < paths.size(); ++level)
+        {
+            uint32_t width, height;
+            decode_bmp(loader.load_bytes(paths[level]), width, height, result.levels[level]);
+
+            if (level == 0)
+            {
+                result.width = width;
+                result.height = height;
+            }
+            else if (width != mip_size(result.width, level) || height != mip_size(result.height, level))
+            {
+                throw std::runtime_error("mip level " + std::to_string(level) + " has the wrong size");
+            }
+        }
+
+        // GLES2 only samples mip chains that go down to 1x1
+        if (result.levels.size() > 1) { complete_mip_chain(result.levels, result.width, result.height); }
+
+        // after the chain is complete, so levels are filtered from full precision
+        for (size_t level = 0; level < result.levels.size(); ++level)
+        {
+            pack_texels(result.levels[level], mip_size(result.width, level), mip_size(result.height, level),
+                format, dither);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        result.levels.clear();
+        result.error = paths.front() + ": " + e.what();
+    }
+
+    return result;
+}
+
+texture_streamer::texture_streamer(const asset_loader& loader)
+    : loader_(loader)
+{
+    worker_ = std::thread([this] { run(); });
+}
+
+texture_streamer::~texture_streamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();
+}
+
+void texture_streamer::request(size_t texture, const std::vector<std::string>& paths,
+    pixel_format format, bool dither)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        requests_.push_back(pending_request { texture, paths, format, dither });
+    }
+    wake_.notify_one();
+}
+
+void texture_streamer::collect(std::vector<decoded_texture>& done)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (auto& texture: done_) { done.emplace_back(std::move(texture)); }
+    done_.clear();
+}
+
+void texture_streamer::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true)
+    {
+        wake_.wait(lock, [this] { return !requests_.empty() || stopping_; });
+        if (stopping_) { return; }
+
+        const pending_request r = std::move(requests_.front());
+        requests_.pop_front();
+
+        lock.unlock();
+        decoded_texture texture = decode_texture(loader_, r.texture, r.paths, r.format, r.dither);
+        lock.lock();
+
+        done_.emplace_back(std::move(texture));
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include "asset_loader.h"
+#include "types.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct decoded_texture
+{
+    size_t texture;
+    uint32_t width;
+    uint32_t height;
+    pixel_format format;
+    // level 0 first, a complete chain when the tier had mip levels
+    std::vector<std::vector<uint8_t>> levels;
+    // empty when loading succeeded
+    std::string error;
+};
+
+// loads and decodes one tier on the calling thread, levels packed into format
+decoded_texture decode_texture(const asset_loader& loader, size_t texture, const std::vector<std::string>& paths,
+    pixel_format format, bool dither);
+
+// Loads and decodes texture pages on a background thread, so a page that
+// becomes visible costs the GL thread only its upload.
+class texture_streamer final
+{
+public:
+    explicit texture_streamer(const asset_loader& loader);
+    ~texture_streamer();
+
+    texture_streamer(const texture_streamer&) = delete;
+    texture_streamer& operator=(const texture_streamer&) = delete;
+
+    // paths of one tier: level 0 first, then offline-built mip levels; the
+    // levels arrive packed into format
+    void request(size_t texture, const std::vector<std::string>& paths, pixel_format format, bool dither);
+
+    // appends pages decoded since the last call; never waits
+    void collect(std::vector<decoded_texture>& done);
+
+private:
+    struct pending_request
+    {
+        size_t texture;
+        std::vector<std::string> paths;
+        pixel_format format;
+        bool dither;
+    };
+
+    asset_loader loader_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<pending_request> requests_;
+    std::vector<decoded_texture> done_;
+    bool stopping_ = false;
+    std::thread worker_;
+
+    void run();
+};
+
+#endif
@@ -0,0 +1,47 @@
+#include "thermal_monitor.h"
+
+#include <dlfcn.h>
+
+#include <cmath>
+
+namespace {
+
+    const int64_t QUERY_INTERVAL = 1000;
+
+    // how far ahead the platform forecasts, in seconds
+    const int FORECAST = 2;
+
+}
+
+thermal_monitor::thermal_monitor()
+    : headroom_(NAN)
+{
+    library_ = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL);
+    if (library_ == nullptr) { return; }
+
+    const auto acquire = reinterpret_cast<acquire_function>(dlsym(library_, "AThermal_acquireManager"));
+    release_ = reinterpret_cast<release_function>(dlsym(library_, "AThermal_releaseManager"));
+    get_headroom_ = reinterpret_cast<headroom_function>(dlsym(library_, "AThermal_getThermalHeadroom"));
+
+    if (acquire != nullptr && release_ != nullptr && get_headroom_ != nullptr) { manager_ = acquire(); }
+}
+
+thermal_monitor::~thermal_monitor()
+{
+    if (manager_ != nullptr) { release_(manager_); }
+    if (library_ != nullptr) { dlclose(library_); }
+}
+
+float thermal_monitor::headroom(int64_t now)
+{
+    if (manager_ == nullptr) { return NAN; }
+
+    if (!queried_ || now - last_query_ >= QUERY_INTERVAL)
+    {
+        queried_ = true;
+        last_query_ = now;
+        headroom_ = get_headroom_(manager_, FORECAST);
+    }
+
+    return headroom_;
+}
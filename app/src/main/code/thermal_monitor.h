@@ -0,0 +1,38 @@
+#ifndef THERMAL_MONITOR_H
+#define THERMAL_MONITOR_H
+
+#include <cstdint>
+
+struct AThermalManager;
+
+// Thermal headroom from AThermal_getThermalHeadroom, looked up at run time
+// because it is only there from API 31. 1 means the device throttles now.
+class thermal_monitor final
+{
+public:
+    thermal_monitor();
+    ~thermal_monitor();
+
+    thermal_monitor(const thermal_monitor&) = delete;
+    thermal_monitor& operator=(const thermal_monitor&) = delete;
+
+    // asks the platform at most once a second, as it requires, and returns
+    // the last answer in between; NaN where headroom is not reported
+    float headroom(int64_t now);
+
+private:
+    using acquire_function = AThermalManager* (*)();
+    using release_function = void (*)(AThermalManager*);
+    using headroom_function = float (*)(AThermalManager*, int);
+
+    void* library_ = nullptr;
+    AThermalManager* manager_ = nullptr;
+    release_function release_ = nullptr;
+    headroom_function get_headroom_ = nullptr;
+
+    bool queried_ = false;
+    int64_t last_query_ = 0;
+    float headroom_;
+};
+
+#endif
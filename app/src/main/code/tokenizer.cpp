@@ -0,0 +1,161 @@
+#include "tokenizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+    // more digits can not change a float
+    const uint64_t MANTISSA_LIMIT = 100000000000000000ull;
+
+    inline bool is_space(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    inline bool is_digit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+}
+
+tokenizer::tokenizer(text_view text)
+    : p_(text.data)
+    , end_(text.data + text.size)
+    , line_start_(text.data)
+    , token_(text.data)
+    , line_(0)
+{}
+
+bool tokenizer::next_line()
+{
+    if (line_ != 0)
+    {
+        skip_line();
+        if (p_ == end_) { return false; }
+        ++p_;
+    }
+
+    while (true)
+    {
+        ++line_;
+        line_start_ = p_;
+
+        skip_spaces();
+        if (p_ == end_) { return false; }
+        if (*p_ != '\n') { return true; }
+        ++p_;
+    }
+}
+
+void tokenizer::skip_line()
+{
+    while (p_ < end_ && *p_ != '\n') { ++p_; }
+}
+
+bool tokenizer::at_line_end()
+{
+    skip_spaces();
+    return p_ == end_ || *p_ == '\n';
+}
+
+void tokenizer::expect_line_end()
+{
+    if (at_line_end()) { return; }
+
+    token_ = p_;
+    fail("unexpected token");
+}
+
+text_view tokenizer::word(const char* what)
+{
+    skip_spaces();
+    token_ = p_;
+
+    while (p_ < end_ && *p_ != '\n' && !is_space(*p_)) { ++p_; }
+
+    if (p_ == token_) { fail(std::string("expected ") + what); }
+    return text_view { token_, size_t(p_ - token_) };
+}
+
+float tokenizer::number()
+{
+    const text_view token = word("number");
+    const char* p = token.data;
+    const char* end = token.data + token.size;
+
+    const bool negative = *p == '-';
+    if (*p == '-' || *p == '+') { ++p; }
+
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    bool digits = false;
+
+    for (; p < end && is_digit(*p); ++p, digits = true)
+    {
+        if (mantissa < MANTISSA_LIMIT) { mantissa = mantissa * 10 + (*p - '0'); }
+        else { ++exponent; }
+    }
+
+    if (p < end && *p == '.')
+    {
+        for (++p; p < end && is_digit(*p); ++p, digits = true)
+        {
+            if (mantissa < MANTISSA_LIMIT)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                --exponent;
+            }
+        }
+    }
+
+    if (digits && p < end && (*p == 'e' || *p == 'E'))
+    {
+        ++p;
+        const bool negative_exponent = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+')) { ++p; }
+
+        int e = 0;
+        if (p == end || !is_digit(*p)) { digits = false; }
+        for (; p < end && is_digit(*p); ++p) { e = std::min(e * 10 + (*p - '0'), 1000); }
+
+        exponent += negative_exponent ? -e : e;
+    }
+
+    if (!digits || p != end) { fail("expected a number, got '" + token.str() + "'"); }
+
+    const double value = mantissa == 0 ? 0.0 : double(mantissa) * std::pow(10.0, exponent);
+    return static_cast<float>(negative ? -value : value);
+}
+
+uint32_t tokenizer::integer()
+{
+    const text_view token = word("integer");
+
+    uint64_t value = 0;
+    for (size_t i = 0; i < token.size; ++i)
+    {
+        const char c = token.data[i];
+        if (!is_digit(c) || value > UINT32_MAX / 10)
+        {
+            fail("expected an integer, got '" + token.str() + "'");
+        }
+        value = value * 10 + (c - '0');
+    }
+
+    if (value > UINT32_MAX) { fail("integer out of range: " + token.str()); }
+    return static_cast<uint32_t>(value);
+}
+
+void tokenizer::fail(const std::string& message) const
+{
+    throw std::runtime_error("line " + std::to_string(line_) + ", column " +
+        std::to_string(token_ - line_start_ + 1) + ": " + message);
+}
+
+void tokenizer::skip_spaces()
+{
+    while (p_ < end_ && is_space(*p_)) { ++p_; }
+}
@@ -0,0 +1,42 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include "text_view.h"
+
+#include <cstdint>
+#include <string>
+
+// Splits line-based text into whitespace-separated tokens in place. Tokens
+// are views into the text; errors name the line and column of the token
+// that failed.
+class tokenizer final
+{
+public:
+    explicit tokenizer(text_view text);
+
+    // moves to the next line that has tokens, skipping whatever is left of
+    // the current one; false at the end of the text
+    bool next_line();
+
+    bool at_line_end();
+    void expect_line_end();
+
+    // `what` names the expected token in error messages
+    text_view word(const char* what);
+    float number();
+    uint32_t integer();
+
+    [[noreturn]] void fail(const std::string& message) const;
+
+private:
+    const char* p_;
+    const char* end_;
+    const char* line_start_;
+    const char* token_;
+    size_t line_;
+
+    void skip_spaces();
+    void skip_line();
+};
+
+#endif
@@ -3,8 +3,9 @@
 
 struct vec2 { float x, y; };
 struct rect { float left, right, bottom, top; };
-struct mat3 { float m[9]; };
+struct affine { float m[6]; };
 
 enum class blend_mode { none, alpha };
+enum class pixel_format { rgba8888, rgb565, rgba5551 };
 
 #endif
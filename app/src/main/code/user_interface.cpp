@@ -1,15 +1,19 @@
 #include "user_interface.h"
 
+#include "animation.h"
 #include "bundle.h"
 #include "game_state.h"
 #include "renderer.h"
 
-user_interface::user_interface(const bundle& b)
-    : score_(b.sprite_array("points-digits"))
-    , result_(b.sprite_array("result-digits"))
-    , best_result_(b.sprite_array("result-digits"))
-    , start_anim_(b.sprite_array("start-anim"), b.value("start-anim-rate"))
-    , repeat_anim_(b.sprite_array("repeat-anim"), b.value("repeat-anim-rate"))
+user_interface::user_interface(const bundle& b, animation_system& animations)
+    : points_font_(b.font("points-font"))
+    , result_font_(b.font("result-font"))
+    , score_(points_font_)
+    , result_(result_font_)
+    , best_result_(result_font_)
+    , animations_(animations)
+    , start_anim_(animations.add(b.clip("start-anim")))
+    , repeat_anim_(animations.add(b.clip("repeat-anim")))
     , popup_(b.sprite("popup"))
     , new_best_(b.sprite("new-best"))
 {
@@ -22,8 +26,8 @@ user_interface::user_interface(const bundle& b)
     best_result_.set_align(b.value("best-align"));
     best_result_.set_offset(b.value("best-offset-x"), b.value("best-offset-y"));
 
-    start_anim_.play(true);
-    repeat_anim_.play(true);
+    animations_.play(start_anim_, true);
+    animations_.play(repeat_anim_, true);
 }
 
 void user_interface::draw(renderer* r, const game_state& state)
@@ -31,29 +35,38 @@ void user_interface::draw(renderer* r, const game_state& state)
     switch (state.phase)
     {
         case game_phase::begin:
-            start_anim_.advance(r->frame_delta());
-            r->draw(start_anim_.frame());
+            r->draw(animations_.frame(start_anim_));
             break;
 
         case game_phase::play:
-            score_.draw(r, state.score);
+            score_.set_number(state.score);
+            score_.draw(r);
             break;
 
         case game_phase::end:
             if (state.timer > 0)
             {
-                score_.draw(r, state.score);
+                score_.set_number(state.score);
+                score_.draw(r);
             }
             else
             {
-                r->draw(popup_);
-                if (state.new_best) { r->draw(new_best_); }
+                // drawn in place, in one call
+                const sprite* sprites[3];
+                size_t count = 0;
 
-                repeat_anim_.advance(r->frame_delta());
-                r->draw(repeat_anim_.frame());
+                sprites[count++] = &popup_;
+                if (state.new_best) { sprites[count++] = &new_best_; }
+                sprites[count++] = &animations_.frame(repeat_anim_);
 
-                result_.draw(r, state.score);
-                best_result_.draw(r, state.best_score);
+                const vec2 positions[3] = {};
+                r->draw(sprites, positions, count);
+
+                result_.set_number(state.score);
+                result_.draw(r);
+
+                best_result_.set_number(state.best_score);
+                best_result_.draw(r);
             }
             break;
     }
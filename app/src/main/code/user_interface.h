@@ -1,11 +1,12 @@
 #ifndef USER_INTERFACE_H
 #define USER_INTERFACE_H
 
-#include "animation.h"
-#include "score_label.h"
+#include "font.h"
+#include "text_label.h"
 
 #include <vector>
 
+class animation_system;
 class bundle;
 struct game_state;
 class renderer;
@@ -13,17 +14,21 @@ class renderer;
 class user_interface final
 {
 public:
-    explicit user_interface(const bundle& b);
+    user_interface(const bundle& b, animation_system& animations);
 
     void draw(renderer* r, const game_state& state);
 
 private:
-    score_label score_;
-    score_label result_;
-    score_label best_result_;
+    font points_font_;
+    font result_font_;
 
-    animation start_anim_;
-    animation repeat_anim_;
+    text_label score_;
+    text_label result_;
+    text_label best_result_;
+
+    animation_system& animations_;
+    size_t start_anim_;
+    size_t repeat_anim_;
 
     sprite popup_;
     sprite new_best_;
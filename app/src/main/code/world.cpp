@@ -1,17 +1,18 @@
 #include "world.h"
 
+#include "affine.h"
+#include "animation.h"
 #include "bundle.h"
-#include "mat3.h"
+#include "frame_arena.h"
 #include "rect.h"
 #include "vec2.h"
 #include "renderer.h"
 
-#include <algorithm>
+#include <cmath>
+#include <ctime>
 
 namespace {
 
-    const size_t NUM_SPANS = 3;
-    const size_t NUM_OBSTACLES_IN_SPAN = 4;
     const size_t NUM_STROKES_IN_SPAN = 6;
     const size_t NUM_BACKS = 2;
 
@@ -22,327 +23,219 @@ namespace {
 
 }
 
-world::world(uint32_t best_score, const bundle& b)
-    : fly_anim_(b.sprite_array("fly-anim"), b.value("fly-anim-rate"))
-    , death_anim_(b.sprite_array("death-anim"), b.value("death-anim-rate"))
+world::world(uint32_t best_score, const bundle& b, animation_system& animations)
+    : simulation_(b)
+    , animations_(animations)
+    , fly_anim_(animations.add(b.clip("fly-anim")))
+    , death_anim_(animations.add(b.clip("death-anim")))
+    , current_anim_(fly_anim_)
     , background_(b.sprite("background"))
     , stroke_sprites_(b.sprite_array("strokes"))
-    , obstacles_(NUM_SPANS * NUM_OBSTACLES_IN_SPAN,
-        obstacle { vec2_zero(), rect_zero(), b.sprite("ground") })
-    , strokes_(NUM_SPANS * NUM_STROKES_IN_SPAN)
-    , spans_(NUM_SPANS)
+    , back_x_(0.0f)
+    , view_random_(static_cast<uint32_t>(time(nullptr)) | 1)
 {
-    srand((unsigned int)time(nullptr));
-
-    state_.best_score = best_score;
-
-    settings_.move_velocity = b.value("move-velocity");
-    settings_.back_velocity = b.value("back-velocity");
-    settings_.jump_velocity = b.value("jump-velocity");
-    settings_.jump_angle = b.value("jump-angle");
-    settings_.rotation_speed = b.value("rotation-speed");
-    settings_.gravity = b.value("gravity");
-    settings_.character_radius = b.value("character-radius");
-    settings_.span_width = b.value("span-width");
-    settings_.tube_width = b.value("tube-width");
-    settings_.bound_inner = b.value("bound-inner");
-    settings_.bound_outer = b.value("bound-outer");
-    settings_.hole_size = b.value("hole-rect_size");
-    settings_.hole_range = b.value("hole-range");
-
-    character_.x = b.value("character-x");
-
-    set_phase(game_phase::begin);
+    const size_t span_count = simulation_.settings().span_count;
+    obstacle_views_.assign(span_count * NUM_OBSTACLES_IN_SPAN, b.sprite("ground"));
+    stroke_matrices_.resize(span_count * NUM_STROKES_IN_SPAN);
+    stroke_indices_.resize(span_count * NUM_STROKES_IN_SPAN);
+
+    // ground views are texture-mapped in world space and rely on texture repeat
+    const sprite ground = b.sprite("ground");
+    const vec2 ground_size = rect_size(ground.rect);
+    ground_uv_scale_.x = (ground.uv.right - ground.uv.left) / ground_size.x;
+    ground_uv_scale_.y = (ground.uv.top - ground.uv.bottom) / ground_size.y;
+
+    simulation_.reset(state_, next_random(view_random_));
+    state_.game.best_score = best_score;
+
+    // as if a round just ended: starts the fly animation, builds every span view
+    sync_views(game_phase::end);
 }
 
-void world::integrate(int64_t dt)
+void world::apply_settings(const bundle& b)
 {
-    old_.character_y = character_.y;
-    old_.world_x = world_x_;
+    simulation_.apply_settings(b);
+}
 
-    float sec = dt * 0.001f;
+void world::restore(const simulation_state& s)
+{
+    const game_phase previous = state_.game.phase;
 
-    switch (state_.phase)
-    {
-        case game_phase::begin:
-            move_spans(sec, false);
-            break;
-
-        case game_phase::play:
-            move_spans(sec, true);
-            move_character(sec);
-
-            state_.score += collect_points();
-
-            if (has_collision())
-            {
-                state_.new_best = state_.score > state_.best_score;
-                if (state_.new_best)
-                {
-                    state_.best_score = state_.score;
-                }
-
-                set_phase(game_phase::end);
-            }
-            break;
-
-        case game_phase::end:
-            state_.timer = std::max<int64_t>(state_.timer - dt, 0);
-            break;
-    }
+    state_ = s;
+    state_.changed_spans = (1u << simulation_.settings().span_count) - 1;
+
+    sync_views(previous);
+}
+
+void world::integrate(int64_t dt)
+{
+    const game_phase previous = state_.game.phase;
+    simulation_.integrate(state_, dt);
+    sync_views(previous);
 }
 
 void world::draw(renderer* r)
 {
+    const simulation_settings& settings = simulation_.settings();
     const float interpolation = r->frame_interpolation();
     const float dt = r->frame_delta() * 0.001f;
 
     const float back_width = rect_size(background_.rect).x;
 
-    if (state_.phase != game_phase::end)
+    if (state_.game.phase != game_phase::end)
     {
-        back_x_ = fmodf(back_x_ - settings_.back_velocity * dt, back_width);
+        back_x_ = fmodf(back_x_ - settings.back_velocity * dt, back_width);
     }
 
-    for (size_t i = 0; i < NUM_BACKS; ++i)
-    {
-        r->draw(background_, vec2 { back_x_ + i * back_width, 0.0f });
-    }
+    frame_arena& arena = r->transient_arena();
 
-    const float world_offset = lerp(old_.world_x, world_x_, interpolation);
+    // backgrounds and obstacles are only moved, they go in one call
+    const size_t placed_count = NUM_BACKS + obstacle_views_.size();
+    const sprite** placed = arena.allocate<const sprite*>(placed_count);
+    vec2* positions = arena.allocate<vec2>(placed_count);
 
-    for (size_t i = 0; i < obstacles_.size(); ++i)
+    for (size_t i = 0; i < NUM_BACKS; ++i)
     {
-        const float span_offset = spans_[i / NUM_OBSTACLES_IN_SPAN].offset_x * settings_.span_width;
-        r->draw(obstacles_[i].view, obstacles_[i].position + vec2 { span_offset + world_offset, 0.0f });
+        placed[i] = &background_;
+        positions[i] = vec2 { back_x_ + i * back_width, 0.0f };
     }
 
-    for (size_t i = 0; i < strokes_.size(); ++i)
-    {
-        const float span_offset = spans_[i / NUM_STROKES_IN_SPAN].offset_x * settings_.span_width;
-        r->draw(stroke_sprites_[strokes_[i].sprite_index],
-             strokes_[i].matrix * mat3_translation(span_offset + world_offset, 0.0f));
-    }
+    const float world_offset = lerp(state_.old.world_x, state_.world_x, interpolation);
 
-    if (current_anim_->advance(r->frame_delta()))
+    for (size_t i = 0; i < obstacle_views_.size(); ++i)
     {
-        if (state_.phase == game_phase::play)
-        {
-            character_.angle += dt * settings_.rotation_speed;
-        }
-
-        const float char_y = lerp(old_.character_y, character_.y, interpolation);
-
-        r->draw(current_anim_->frame(),
-            mat3_rotation(character_.angle) * mat3_translation(character_.x, char_y)
-        );
+        const simulation_state::span& s = state_.spans[i / NUM_OBSTACLES_IN_SPAN];
+        const float span_offset = s.offset_x * settings.span_width;
+        placed[NUM_BACKS + i] = &obstacle_views_[i];
+        positions[NUM_BACKS + i] =
+            s.obstacles[i % NUM_OBSTACLES_IN_SPAN].position + vec2 { span_offset + world_offset, 0.0f };
     }
-}
 
-void world::handle_tap()
-{
-    switch (state_.phase)
-    {
-        case game_phase::begin:
-            set_phase(game_phase::play);
-            break;
-
-        case game_phase::play:
-            character_.velocity = settings_.jump_velocity;
-            character_.angle = settings_.jump_angle;
-            break;
-
-        case game_phase::end:
-            if (state_.timer == 0)
-            {
-                set_phase(game_phase::begin);
-            }
-            break;
-    }
-}
+    r->draw(placed, positions, placed_count);
 
-void world::set_phase(game_phase phase)
-{
-    state_.phase = phase;
+    affine* matrices = arena.allocate<affine>(stroke_matrices_.size());
+    const sprite** strokes = arena.allocate<const sprite*>(stroke_matrices_.size());
 
-    switch (state_.phase)
+    for (size_t i = 0; i < settings.span_count; ++i)
     {
-        case game_phase::begin:
-            state_.score = 0;
-
-            character_.y = 0.0f;
-            character_.velocity = 0.0f;
-            character_.angle = 0.0f;
-
-            fly_anim_.play(true);
-            current_anim_ = &fly_anim_;
-
-            reset_spans();
-            break;
-
-        case game_phase::play:
-            character_.velocity = settings_.jump_velocity;
-            character_.angle = settings_.jump_angle;
-            break;
-
-        case game_phase::end:
-            state_.timer = 1000;
-
-            death_anim_.play(false);
-            current_anim_ = &death_anim_;
-
-            character_.angle = 0.0f;
-            break;
+        const float span_offset = state_.spans[i].offset_x * settings.span_width;
+        const size_t first = i * NUM_STROKES_IN_SPAN;
+        affine_compose_batch(&stroke_matrices_[first], affine_translation(span_offset + world_offset, 0.0f),
+            &matrices[first], NUM_STROKES_IN_SPAN);
     }
-}
 
-void world::move_spans(float sec, bool add_hole)
-{
-    world_x_ -= settings_.move_velocity * sec;
+    for (size_t i = 0; i < stroke_matrices_.size(); ++i) { strokes[i] = &stroke_sprites_[stroke_indices_[i]]; }
 
-    for (size_t i = 0; i < NUM_SPANS; ++i)
-    {
-        span& s = spans_[i];
-        const float span_offset = world_x_ + s.offset_x * settings_.span_width;
-        if (span_offset > -2.0f * settings_.span_width) { continue; }
+    r->draw(strokes, matrices, stroke_matrices_.size());
 
-        s.offset_x += NUM_SPANS;
-
-        if (add_hole)
-        {
-            s.points = 1;
-
-            const float arb = settings_.hole_range * (rand() / (float)RAND_MAX - 0.5f);
-            obstacle* obstacles = &obstacles_[i * NUM_OBSTACLES_IN_SPAN];
-            obstacles[2].collider.top = settings_.bound_outer + arb - (settings_.hole_size * 0.5f);
-            obstacles[3].collider.bottom = -settings_.bound_outer + arb + (settings_.hole_size  * 0.5f);
-        }
+    if (animations_.is_playing(current_anim_))
+    {
+        const float char_y = lerp(state_.old.character_y, state_.character.y, interpolation);
+        const float char_angle = lerp(state_.old.character_angle, state_.character.angle, interpolation);
 
-        update_span_view(i);
+        r->draw(animations_.frame(current_anim_),
+            affine_rotation(char_angle) * affine_translation(settings.character_x, char_y)
+        );
     }
 }
 
-void world::move_character(float sec)
+void world::handle_tap()
 {
-    character_.velocity += settings_.gravity * sec;
-    character_.y += character_.velocity * sec;
+    const game_phase previous = state_.game.phase;
+    simulation_.handle_tap(state_);
+    sync_views(previous);
 }
 
-uint32_t world::collect_points()
+void world::sync_views(game_phase previous)
 {
-    const float tube_center = settings_.span_width - 0.5f * settings_.tube_width;
-    uint32_t points = 0;
-
-    for (auto& s: spans_)
+    if (state_.game.phase != previous)
     {
-        if (s.points == 0) { continue; }
-        const float span_offset = world_x_ + s.offset_x * settings_.span_width;
-        if (character_.x > span_offset + tube_center)
+        switch (state_.game.phase)
         {
-            points += s.points;
-            s.points = 0;
+            case game_phase::begin:
+                back_x_ = 0.0f;
+                animations_.play(fly_anim_, true);
+                current_anim_ = fly_anim_;
+                break;
+
+            case game_phase::play:
+                break;
+
+            case game_phase::end:
+                animations_.play(death_anim_, false);
+                current_anim_ = death_anim_;
+                break;
         }
     }
 
-    return points;
-}
-
-bool world::has_collision() const
-{
-    const vec2 c { character_.x, character_.y };
-    const float sqr = settings_.character_radius * settings_.character_radius;
-
-    for (size_t i = 0; i < obstacles_.size(); ++i)
+    for (size_t i = 0; state_.changed_spans != 0; ++i)
     {
-        const size_t span_index = i / NUM_OBSTACLES_IN_SPAN;
-        const float span_offset = world_x_ + spans_[span_index].offset_x * settings_.span_width;
-
-        const obstacle& o = obstacles_[i];
-        const auto rect = o.collider + o.position + vec2 { span_offset, 0.0f };
-
-        float dx = (c.x < rect.left) ? rect.left : (c.x > rect.right) ? rect.right : c.x;
-        float dy = (c.y < rect.bottom) ? rect.bottom : (c.y > rect.top) ? rect.top : c.y;
-
-        dx -= c.x;
-        dy -= c.y;
-
-        if (dx * dx + dy * dy < sqr) { return true; }
-    }
-
-    return false;
-}
-
-void world::reset_spans()
-{
-    world_x_ = -settings_.span_width * 2.0f;
-    back_x_ = 0.0f;
-
-    const float tube_offset = settings_.span_width - settings_.tube_width;
-    const float ground_height = settings_.bound_outer - settings_.bound_inner;
-
-    for (uint32_t i = 0; i < NUM_SPANS; ++i)
-    {
-        spans_[i].offset_x = i;
-        spans_[i].points = 0;
-
-        obstacle* obstacles = &obstacles_[i * NUM_OBSTACLES_IN_SPAN];
-
-        obstacles[0].position = { 0.0f, -settings_.bound_outer };
-        obstacles[0].collider = { 0.0f, tube_offset, 0.0f, ground_height };
-
-        obstacles[1].position = { 0.0f, settings_.bound_outer };
-        obstacles[1].collider = { 0.0f, tube_offset, -ground_height, 0.0f };
-
-        obstacles[2].position = { tube_offset, -settings_.bound_outer };
-        obstacles[2].collider = { 0.0f, settings_.tube_width, 0.0f, ground_height };
-
-        obstacles[3].position = { tube_offset, settings_.bound_outer };
-        obstacles[3].collider = { 0.0f, settings_.tube_width, -ground_height, 0.0f };
+        const uint32_t bit = 1u << i;
+        if ((state_.changed_spans & bit) == 0) { continue; }
 
         update_span_view(i);
+        state_.changed_spans &= ~bit;
     }
 }
 
 void world::update_span_view(size_t span_index)
 {
+    const simulation_settings& settings = simulation_.settings();
+    const simulation_state::span& s = state_.spans[span_index];
+    const simulation_state::obstacle* obstacles = s.obstacles;
+
     const vec2 span_offset {
-        spans_[span_index].offset_x * settings_.span_width,
-        settings_.bound_outer
+        s.offset_x * settings.span_width,
+        settings.bound_outer
     };
 
-    obstacle* obstacles = &obstacles_[span_index * NUM_OBSTACLES_IN_SPAN];
+    sprite* views = &obstacle_views_[span_index * NUM_OBSTACLES_IN_SPAN];
     for (size_t i = 0; i < NUM_OBSTACLES_IN_SPAN; ++i)
     {
-
-        obstacle& o = obstacles[i];
-        o.view.rect = o.collider + o.position + span_offset;
-        o.view.origin.y = -o.collider.bottom;
+        const simulation_state::obstacle& o = obstacles[i];
+        sprite& view = views[i];
+        view.rect = o.collider + o.position + span_offset;
+
+        // mapped in world space, less the whole repeats of the page, which
+        // would leave the fixed-point range of batch_vertex within seconds
+        const vec2 uv_repeats {
+            std::floor(view.rect.left * ground_uv_scale_.x),
+            std::floor(view.rect.bottom * ground_uv_scale_.y)
+        };
+        view.uv = rect {
+            view.rect.left * ground_uv_scale_.x - uv_repeats.x,
+            view.rect.right * ground_uv_scale_.x - uv_repeats.x,
+            view.rect.bottom * ground_uv_scale_.y - uv_repeats.y,
+            view.rect.top * ground_uv_scale_.y - uv_repeats.y
+        };
+        view.origin.y = -o.collider.bottom;
     }
 
-    const float tube_x = settings_.span_width - settings_.tube_width;
-    const float ground = settings_.bound_outer - settings_.bound_inner;
+    const float tube_x = settings.span_width - settings.tube_width;
+    const float ground = settings.bound_outer - settings.bound_inner;
     const float bottom = rect_size(obstacles[2].collider).y - ground;
     const float top = rect_size(obstacles[3].collider).y - ground;
 
-    const float len[] = { 3.0f + tube_x, -bottom, settings_.tube_width, -bottom, top, top };
+    const float len[] = { 3.0f + tube_x, -bottom, settings.tube_width, -bottom, top, top };
     const float rot[] = { 0.0f, -1.0f, 0.0f, 1.0f, -1.0f, 1.0f };
     const vec2 pos[] = {
-        { -2.0f, -settings_.bound_inner },
-        { tube_x, -settings_.bound_inner + bottom },
-        { tube_x, -settings_.bound_inner + bottom },
-        { settings_.span_width, -settings_.bound_inner },
-        { tube_x, settings_.bound_inner - top },
-        { settings_.span_width, settings_.bound_inner }
+        { -2.0f, -settings.bound_inner },
+        { tube_x, -settings.bound_inner + bottom },
+        { tube_x, -settings.bound_inner + bottom },
+        { settings.span_width, -settings.bound_inner },
+        { tube_x, settings.bound_inner - top },
+        { settings.span_width, settings.bound_inner }
     };
 
-    stroke* strokes = &strokes_[span_index * NUM_STROKES_IN_SPAN];
+    affine* matrices = &stroke_matrices_[span_index * NUM_STROKES_IN_SPAN];
+    size_t* indices = &stroke_indices_[span_index * NUM_STROKES_IN_SPAN];
     for (size_t i = 0; i < NUM_STROKES_IN_SPAN; ++i)
     {
-        size_t sprite_index = rand() % stroke_sprites_.size();
-        strokes[i].sprite_index = sprite_index;
-        strokes[i].matrix =
-            mat3_scaling(len[i] / rect_size(stroke_sprites_[sprite_index].rect).x, 1.0f) *
-            mat3_rotation(rot[i] * 90.0f) *
-            mat3_translation(pos[i].x, pos[i].y);
+        size_t sprite_index = next_random(view_random_) % stroke_sprites_.size();
+        indices[i] = sprite_index;
+        matrices[i] =
+            affine_scaling(len[i] / rect_size(stroke_sprites_[sprite_index].rect).x, 1.0f) *
+            affine_rotation(rot[i] * 90.0f) *
+            affine_translation(pos[i].x, pos[i].y);
     }
 }
@@ -0,0 +1,53 @@
+#include "alloc_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+    std::atomic<size_t> allocations { 0 };
+
+    void* counted_alloc(size_t size)
+    {
+        ++allocations;
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+}
+
+size_t alloc_counter::count()
+{
+    return allocations.load();
+}
+
+void* operator new(size_t size)
+{
+    void* p = counted_alloc(size);
+    if (p == nullptr) { throw std::bad_alloc(); }
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    void* p = counted_alloc(size);
+    if (p == nullptr) { throw std::bad_alloc(); }
+    return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_alloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_alloc(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
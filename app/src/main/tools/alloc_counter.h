@@ -0,0 +1,14 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cstddef>
+
+// Counts every global operator new call made by the process.
+// Linking alloc_counter.cpp replaces the global allocation functions.
+namespace alloc_counter {
+
+    size_t count();
+
+}
+
+#endif
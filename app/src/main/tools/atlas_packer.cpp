@@ -0,0 +1,539 @@
+// Offline texture atlas packer.
+//
+// Reads a bundle manifest, packs the images it lists into texture pages and
+// writes a ready-to-ship bundle.txt with normalized UVs. Manifest lines:
+//
+//   atlas-page <width> <height>
+//   atlas-tiers <divisor>...
+//   atlas-mips <levels>
+//   atlas-material <id> <blend-mode> <shader-id>
+//   atlas-image <sprite-id> <material-id> <path> <origin-x> <origin-y>
+//
+// atlas-tiers also writes every page at 1/divisor of its size (powers of two)
+// for low resolution screens; images are then aligned to the largest divisor
+// so they do not share texels once shrunk. atlas-mips writes that many mip
+// levels for every tier; the renderer builds the rest of the chain.
+// atlas-image lines are listed in draw order. Every other line is copied to
+// the output unchanged and in manifest order: textures and materials take the
+// place of the first atlas-material line, sprite-uv lines that of their
+// atlas-image line, so shaders go above the atlas lines. The output is parsed
+// back before the packer reports success. Images of one material are kept on one page whenever
+// they fit, so draw runs of a material never split into several batches.
+// Materials that use texture repeat (like ground) can not live in an atlas.
+//
+// usage: atlas_packer <manifest> <output-dir>
+// writes <output-dir>/bundle.txt and <output-dir>/textures/atlas-<n>.bmp,
+// tiers and mip levels as atlas-<n>-d<divisor>-m<level>.bmp
+
+#include "../code/bundle.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+    const uint32_t PADDING = 1;
+    const uint8_t COLOR_KEY[] = { 0xff, 0x00, 0xff };
+
+    struct image
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> rgb; // bottom-up rows, no padding
+    };
+
+    struct atlas_material
+    {
+        std::string id;
+        std::string blend;
+        std::string shader;
+    };
+
+    struct atlas_image
+    {
+        std::string sprite_id;
+        size_t material;
+        // passthrough lines above it in the manifest
+        size_t line;
+        float origin_x, origin_y;
+        image pixels;
+        size_t page;
+        uint32_t x, y;
+    };
+
+    struct page
+    {
+        image pixels;
+        uint32_t shelf_x = 0;
+        uint32_t shelf_y = 0;
+        uint32_t shelf_height = 0;
+    };
+
+    uint32_t read_u32(const std::vector<uint8_t>& b, size_t offset)
+    {
+        return b[offset] | (b[offset + 1] << 8) | (b[offset + 2] << 16) | (uint32_t(b[offset + 3]) << 24);
+    }
+
+    void write_u32(std::ostream& s, uint32_t v)
+    {
+        const char bytes[] = { char(v), char(v >> 8), char(v >> 16), char(v >> 24) };
+        s.write(bytes, 4);
+    }
+
+    void write_u16(std::ostream& s, uint16_t v)
+    {
+        const char bytes[] = { char(v), char(v >> 8) };
+        s.write(bytes, 2);
+    }
+
+    image load_bmp(const std::string& path)
+    {
+        std::ifstream s { path, std::ios::binary };
+        if (!s.is_open()) { throw std::runtime_error("can not open " + path); }
+
+        std::vector<uint8_t> b { std::istreambuf_iterator<char>(s), std::istreambuf_iterator<char>() };
+        if (b.size() < 54 || b[0] != 'B' || b[1] != 'M') { throw std::runtime_error("not a bmp: " + path); }
+        if (b[28] != 24 || read_u32(b, 30) != 0) { throw std::runtime_error("expected 24-bit rgb bmp: " + path); }
+
+        const uint32_t data = read_u32(b, 10);
+        const int32_t height = static_cast<int32_t>(read_u32(b, 22));
+
+        image img;
+        img.width = read_u32(b, 18);
+        img.height = static_cast<uint32_t>(height < 0 ? -height : height);
+        img.rgb.resize(3 * img.width * img.height);
+
+        const size_t stride = (3 * img.width + 3) & ~size_t(3);
+        if (b.size() < data + stride * img.height) { throw std::runtime_error("truncated bmp: " + path); }
+
+        for (uint32_t y = 0; y < img.height; ++y)
+        {
+            const uint32_t row = height < 0 ? img.height - 1 - y : y;
+            const uint8_t* src = &b[data + row * stride];
+            uint8_t* dst = &img.rgb[3 * y * img.width];
+            for (uint32_t x = 0; x < img.width; ++x)
+            {
+                dst[3 * x] = src[3 * x + 2];
+                dst[3 * x + 1] = src[3 * x + 1];
+                dst[3 * x + 2] = src[3 * x];
+            }
+        }
+
+        return img;
+    }
+
+    void save_bmp(const std::string& path, const image& img)
+    {
+        std::ofstream s { path, std::ios::binary };
+        if (!s.is_open()) { throw std::runtime_error("can not write " + path); }
+
+        const uint32_t stride = (3 * img.width + 3) & ~uint32_t(3);
+        const uint32_t size = stride * img.height;
+
+        s.write("BM", 2);
+        write_u32(s, 54 + size);
+        write_u32(s, 0);
+        write_u32(s, 54);
+        write_u32(s, 40);
+        write_u32(s, img.width);
+        write_u32(s, img.height);
+        write_u16(s, 1);
+        write_u16(s, 24);
+        write_u32(s, 0);
+        write_u32(s, size);
+        write_u32(s, 2835);
+        write_u32(s, 2835);
+        write_u32(s, 0);
+        write_u32(s, 0);
+
+        std::vector<char> row(stride, 0);
+        for (uint32_t y = 0; y < img.height; ++y)
+        {
+            const uint8_t* src = &img.rgb[3 * y * img.width];
+            for (uint32_t x = 0; x < img.width; ++x)
+            {
+                row[3 * x] = char(src[3 * x + 2]);
+                row[3 * x + 1] = char(src[3 * x + 1]);
+                row[3 * x + 2] = char(src[3 * x]);
+            }
+            s.write(row.data(), stride);
+        }
+    }
+
+    page make_page(uint32_t width, uint32_t height)
+    {
+        page p;
+        p.pixels.width = width;
+        p.pixels.height = height;
+        p.pixels.rgb.resize(3 * width * height);
+        for (size_t i = 0; i < p.pixels.rgb.size(); i += 3)
+        {
+            std::copy(COLOR_KEY, COLOR_KEY + 3, &p.pixels.rgb[i]);
+        }
+        return p;
+    }
+
+    inline uint32_t align_up(uint32_t v, uint32_t align)
+    {
+        return (v + align - 1) / align * align;
+    }
+
+    // shelf packing: rows of images, tallest first, corners on multiples of align
+    bool place(page& p, atlas_image& img, uint32_t align)
+    {
+        const uint32_t w = align_up(img.pixels.width + PADDING, align);
+        const uint32_t h = align_up(img.pixels.height + PADDING, align);
+
+        if (p.shelf_x + w > p.pixels.width)
+        {
+            p.shelf_y += p.shelf_height;
+            p.shelf_x = 0;
+            p.shelf_height = 0;
+        }
+
+        if (w > p.pixels.width || p.shelf_y + h > p.pixels.height) { return false; }
+
+        img.x = p.shelf_x;
+        img.y = p.shelf_y;
+        p.shelf_x += w;
+        p.shelf_height = std::max(p.shelf_height, h);
+
+        for (uint32_t y = 0; y < img.pixels.height; ++y)
+        {
+            std::copy_n(&img.pixels.rgb[3 * y * img.pixels.width], 3 * img.pixels.width,
+                &p.pixels.rgb[3 * ((img.y + y) * p.pixels.width + img.x)]);
+        }
+
+        return true;
+    }
+
+    uint64_t area(const std::vector<atlas_image*>& images, uint32_t align)
+    {
+        uint64_t a = 0;
+        for (auto i: images)
+        {
+            a += uint64_t(align_up(i->pixels.width + PADDING, align)) * align_up(i->pixels.height + PADDING, align);
+        }
+        return a;
+    }
+
+    bool is_key(const uint8_t* rgb)
+    {
+        return std::equal(rgb, rgb + 3, COLOR_KEY);
+    }
+
+    // box filter over divisor x divisor blocks that skips color-keyed pixels,
+    // so sprite edges do not pick up the key color
+    image shrink(const image& img, uint32_t divisor)
+    {
+        image out;
+        out.width = std::max(img.width / divisor, 1u);
+        out.height = std::max(img.height / divisor, 1u);
+        out.rgb.resize(3 * out.width * out.height);
+
+        for (uint32_t y = 0; y < out.height; ++y)
+        {
+            for (uint32_t x = 0; x < out.width; ++x)
+            {
+                uint32_t sum[3] = { 0, 0, 0 };
+                uint32_t count = 0;
+
+                for (uint32_t by = y * divisor; by < std::min((y + 1) * divisor, img.height); ++by)
+                {
+                    for (uint32_t bx = x * divisor; bx < std::min((x + 1) * divisor, img.width); ++bx)
+                    {
+                        const uint8_t* src = &img.rgb[3 * (by * img.width + bx)];
+                        if (is_key(src)) { continue; }
+
+                        for (size_t c = 0; c < 3; ++c) { sum[c] += src[c]; }
+                        ++count;
+                    }
+                }
+
+                uint8_t* dst = &out.rgb[3 * (y * out.width + x)];
+                if (count == 0) { std::copy(COLOR_KEY, COLOR_KEY + 3, dst); continue; }
+
+                for (size_t c = 0; c < 3; ++c) { dst[c] = uint8_t((sum[c] + count / 2) / count); }
+                // an average that lands on the key would turn transparent
+                if (is_key(dst)) { dst[1] = 1; }
+            }
+        }
+
+        return out;
+    }
+
+    bool is_power_of_two(uint32_t v)
+    {
+        return v != 0 && (v & (v - 1)) == 0;
+    }
+
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        std::cerr << "usage: atlas_packer <manifest> <output-dir>" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        const std::string manifest_path = argv[1];
+        const std::string output_dir = argv[2];
+        const size_t slash = manifest_path.find_last_of('/');
+        const std::string root = slash == std::string::npos ? "" : manifest_path.substr(0, slash + 1);
+
+        std::ifstream manifest { manifest_path };
+        if (!manifest.is_open()) { throw std::runtime_error("can not open " + manifest_path); }
+
+        uint32_t page_width = 256, page_height = 256;
+        std::vector<uint32_t> tiers;
+        uint32_t mip_levels = 0;
+        std::vector<atlas_material> materials;
+        std::unordered_map<std::string, size_t> materials_table;
+        std::vector<atlas_image> images;
+        std::vector<std::string> passthrough;
+        // passthrough lines above the first atlas-material line
+        size_t materials_line = SIZE_MAX;
+        // the output keeps the manifest's line endings
+        std::string eol = "\n";
+
+        std::string line;
+        while (std::getline(manifest, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.pop_back();
+                eol = "\r\n";
+            }
+
+            std::stringstream s { line };
+            std::string type;
+            s >> type;
+
+            if (type == "atlas-page")
+            {
+                s >> page_width >> page_height;
+            }
+            else if (type == "atlas-tiers")
+            {
+                uint32_t divisor;
+                while (s >> divisor)
+                {
+                    if (!is_power_of_two(divisor) || divisor == 1)
+                    {
+                        throw std::runtime_error("tier divisors are powers of two above 1");
+                    }
+                    tiers.push_back(divisor);
+                }
+                std::sort(tiers.begin(), tiers.end());
+            }
+            else if (type == "atlas-mips")
+            {
+                s >> mip_levels;
+            }
+            else if (type == "atlas-material")
+            {
+                atlas_material m;
+                s >> m.id >> m.blend >> m.shader;
+                materials_line = std::min(materials_line, passthrough.size());
+                materials_table.emplace(m.id, materials.size());
+                materials.emplace_back(m);
+            }
+            else if (type == "atlas-image")
+            {
+                atlas_image img;
+                std::string material_id, path;
+                s >> img.sprite_id >> material_id >> path >> img.origin_x >> img.origin_y;
+                img.material = materials_table.at(material_id);
+                img.line = passthrough.size();
+                img.pixels = load_bmp(root + path);
+                images.emplace_back(std::move(img));
+            }
+            else
+            {
+                passthrough.emplace_back(line);
+            }
+        }
+
+        materials_line = std::min(materials_line, passthrough.size());
+
+        const uint32_t align = tiers.empty() ? 1 : tiers.back();
+        if (page_width % align != 0 || page_height % align != 0)
+        {
+            throw std::runtime_error("page size is not a multiple of the largest tier divisor");
+        }
+
+        // materials in order of first use, images of each tallest first
+        std::vector<size_t> material_order;
+        std::vector<std::vector<atlas_image*>> by_material(materials.size());
+        for (auto& img: images)
+        {
+            if (by_material[img.material].empty()) { material_order.push_back(img.material); }
+            by_material[img.material].push_back(&img);
+        }
+
+        std::vector<page> pages;
+        // (material, page) pairs, each becomes one bundle material
+        std::vector<std::pair<size_t, size_t>> page_materials;
+
+        for (size_t m: material_order)
+        {
+            auto& list = by_material[m];
+            std::stable_sort(list.begin(), list.end(), [](const atlas_image* a, const atlas_image* b)
+            {
+                return a->pixels.height > b->pixels.height;
+            });
+
+            // keep the material on one page: open a fresh page when the rest of
+            // the current one is obviously too small but an empty page is not
+            if (!pages.empty())
+            {
+                const page& p = pages.back();
+                const uint64_t left = uint64_t(p.pixels.width) * (p.pixels.height - p.shelf_y - p.shelf_height);
+                if (area(list, align) > left && area(list, align) <= uint64_t(page_width) * page_height)
+                {
+                    pages.emplace_back(make_page(page_width, page_height));
+                }
+            }
+
+            for (auto img: list)
+            {
+                if (pages.empty() || !place(pages.back(), *img, align))
+                {
+                    pages.emplace_back(make_page(page_width, page_height));
+                    if (!place(pages.back(), *img, align))
+                    {
+                        throw std::runtime_error("image does not fit a page: " + img->sprite_id);
+                    }
+                }
+
+                img->page = pages.size() - 1;
+                const auto key = std::make_pair(m, img->page);
+                if (std::find(page_materials.begin(), page_materials.end(), key) == page_materials.end())
+                {
+                    page_materials.push_back(key);
+                }
+            }
+        }
+
+        auto material_name = [&](size_t m, size_t p)
+        {
+            size_t n = 0;
+            for (auto& pm: page_materials)
+            {
+                if (pm.first != m) { continue; }
+                if (pm.second == p) { break; }
+                ++n;
+            }
+            return n == 0 ? materials[m].id : materials[m].id + "-" + std::to_string(n);
+        };
+
+        std::ostringstream out;
+        out.precision(9);
+
+        for (size_t i = 0; i < materials_line; ++i) { out << passthrough[i] << eol; }
+
+        for (size_t i = 0; i < pages.size(); ++i)
+        {
+            const std::string name = "atlas-" + std::to_string(i);
+            save_bmp(output_dir + "/textures/" + name + ".bmp", pages[i].pixels);
+            out << "texture " << name << " textures/" << name << ".bmp "
+                << page_width << " " << page_height << eol;
+        }
+
+        std::vector<uint32_t> divisors { 1 };
+        divisors.insert(divisors.end(), tiers.begin(), tiers.end());
+
+        for (size_t i = 0; i < pages.size() && (tiers.size() + mip_levels) != 0; ++i)
+        {
+            const std::string name = "atlas-" + std::to_string(i);
+
+            for (uint32_t divisor: divisors)
+            {
+                if (divisor == 1 && mip_levels == 0) { continue; }
+
+                out << "texture-tier " << name << " " << divisor;
+
+                // every level is shrunk from the full page, not from the level before
+                const uint32_t largest = std::max(page_width, page_height);
+                for (uint32_t level = 0; level <= mip_levels && (divisor << level) <= largest; ++level)
+                {
+                    if (level == 0 && divisor == 1)
+                    {
+                        out << " textures/" << name << ".bmp";
+                        continue;
+                    }
+
+                    const std::string path = "textures/" + name + "-d" + std::to_string(divisor) +
+                        "-m" + std::to_string(level) + ".bmp";
+                    save_bmp(output_dir + "/" + path, shrink(pages[i].pixels, divisor << level));
+                    out << " " << path;
+                }
+
+                out << eol;
+            }
+        }
+        out << eol;
+
+        for (auto& pm: page_materials)
+        {
+            const auto& m = materials[pm.first];
+            out << "material " << material_name(pm.first, pm.second) << " "
+                << m.blend << " " << m.shader << " atlas-" << pm.second << eol;
+        }
+        out << eol;
+
+        size_t switches = 0;
+        std::string last_material;
+        size_t next_line = materials_line;
+        for (auto& img: images)
+        {
+            for (; next_line < img.line; ++next_line) { out << passthrough[next_line] << eol; }
+
+            const std::string material = material_name(img.material, img.page);
+            if (!last_material.empty() && material != last_material) { ++switches; }
+            last_material = material;
+
+            out << "sprite-uv " << img.sprite_id << " " << material << " "
+                << img.pixels.width << " " << img.pixels.height << " "
+                << img.origin_x << " " << img.origin_y << " "
+                << float(img.x) / page_width << " "
+                << float(img.x + img.pixels.width) / page_width << " "
+                << float(img.y) / page_height << " "
+                << float(img.y + img.pixels.height) / page_height << eol;
+        }
+
+        for (; next_line < passthrough.size(); ++next_line) { out << passthrough[next_line] << eol; }
+
+        const std::string text = out.str();
+        std::ofstream file { output_dir + "/bundle.txt", std::ios::binary };
+        if (!file.is_open()) { throw std::runtime_error("can not write " + output_dir + "/bundle.txt"); }
+        file << text;
+        file.close();
+
+        // what the game would fail to load should fail here
+        bundle parsed;
+        parse_bundle(text_view { text }, parsed);
+
+        std::cout << images.size() << " images, " << pages.size() << " pages, "
+            << page_materials.size() << " materials, "
+            << switches << " material switches in draw order" << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "atlas_packer: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,261 @@
+// Runs the game headless through every phase and fails when game::integrate,
+// game::draw or a tap allocates from the heap once warm-up is over, or when
+// a vertex falls outside the fixed-point range of the sprite batch. Also
+// fails when a 30 Hz run of the rules ends differently from a 60 Hz one, or
+// when a rollout from a snapshot differs from the live, drawn game.
+//
+// usage: frame_check <bundle.txt>
+
+#include "alloc_counter.h"
+
+#include "../code/bundle.h"
+#include "../code/frame_arena.h"
+#include "../code/game.h"
+#include "../code/renderer.h"
+#include "../code/simulation.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+    const int64_t DELTA_TIME = 1000 / 60;
+    const size_t WARM_UP_ROUNDS = 2;
+    const size_t CHECKED_ROUNDS = 3;
+    // two minutes on the begin screen, where the world keeps scrolling;
+    // ground texture coordinates left the fixed-point range after 18 s
+    const size_t LONG_ROUND_FRAMES = 120 * 60;
+
+    struct frame_runner
+    {
+        game& g;
+        renderer& r;
+        bool checked;
+        size_t frame;
+        size_t failures;
+
+        template<class F>
+        void step(const char* what, F f)
+        {
+            const size_t before = alloc_counter::count();
+            f();
+            const size_t allocated = alloc_counter::count() - before;
+
+            if (checked && allocated != 0)
+            {
+                std::printf("frame %zu: %s allocated %zu times\n", frame, what, allocated);
+                ++failures;
+            }
+        }
+
+        void frames(size_t count)
+        {
+            for (size_t i = 0; i < count; ++i, ++frame)
+            {
+                step("game::integrate", [this] { g.integrate(DELTA_TIME); });
+
+                r.begin_frame(0.5f, DELTA_TIME);
+                step("game::draw", [this] { g.draw(&r); });
+                r.end_frame();
+            }
+        }
+
+        void tap()
+        {
+            step("game::handle_tap_down", [this] { g.handle_tap_down(); });
+        }
+
+        // begin -> play -> end -> begin
+        void round()
+        {
+            frames(30);
+            tap();
+            frames(10);
+            tap();
+            frames(300);
+            frames(70);
+            tap();
+        }
+
+        // begin, idle for a long time, then through the other phases
+        void long_round()
+        {
+            frames(LONG_ROUND_FRAMES);
+            round();
+        }
+    };
+
+    // Holes are wide and centered, and gravity is set so a jump lands where
+    // it started after TAP_PERIOD, a whole number of ticks at both rates.
+    // Taps keep the character level, then stop and it falls to the ground.
+    const char* TICK_RATE_VALUES[] = {
+        "value hole-range 0",
+        "value hole-rect_size 100",
+        "value gravity -681.818182"
+    };
+    const int64_t TAP_PERIOD = 528;
+    const int64_t TAPS = 40;
+    const int64_t RUN_LIMIT = 60000;
+
+    struct run_result
+    {
+        int64_t end_time;
+        uint32_t score;
+    };
+
+    run_result run_rules(const simulation& rules, int64_t dt)
+    {
+        simulation_state s;
+        rules.reset(s, 1);
+
+        int64_t time = 0;
+        int64_t taps = 0;
+        while (s.game.phase != game_phase::end && time < RUN_LIMIT)
+        {
+            // as in app_delegate, taps land on the tick that covers them
+            for (; taps < TAPS && taps * TAP_PERIOD < time + dt; ++taps) { rules.handle_tap(s); }
+
+            rules.integrate(s, dt);
+            time += dt;
+        }
+
+        return run_result { time, s.game.score };
+    }
+
+    // the tick rate should change when a run ends by at most a 30 Hz tick,
+    // and never its score
+    bool check_tick_rates(const std::string& text)
+    {
+        bundle b;
+        parse_bundle(text, b);
+        for (auto line: TICK_RATE_VALUES) { b.patch_entry(text_view { line, std::strlen(line) }); }
+
+        const simulation rules(b);
+        const run_result fast = run_rules(rules, 1000 / 60);
+        const run_result slow = run_rules(rules, 1000 / 30);
+
+        std::printf("60 Hz run ends at %lld ms with %u points, 30 Hz at %lld ms with %u points\n",
+            static_cast<long long>(fast.end_time), fast.score, static_cast<long long>(slow.end_time), slow.score);
+
+        return fast.end_time < RUN_LIMIT && fast.score > 0 && fast.score == slow.score &&
+            std::llabs(fast.end_time - slow.end_time) <= 1000 / 30;
+    }
+
+    // through play, the end and the next begin, compared every few ticks
+    const size_t ROLLOUT_TICKS = 320;
+    const size_t ROLLOUT_CHECK_EVERY = 10;
+    const uint32_t ROLLOUT_TAPS[] = { 0, 25, 50, 75, 100, 125, 150, 175, 290 };
+
+    bool same_rect(const rect& a, const rect& b)
+    {
+        return a.left == b.left && a.right == b.right && a.bottom == b.bottom && a.top == b.top;
+    }
+
+    // every field the rules own; changed_spans belongs to whoever shows them
+    bool same_state(const simulation_state& a, const simulation_state& b, size_t span_count)
+    {
+        bool same = a.game.phase == b.game.phase && a.game.best_score == b.game.best_score &&
+            a.game.score == b.game.score && a.game.new_best == b.game.new_best &&
+            a.game.timer == b.game.timer && a.game.runs == b.game.runs &&
+            a.character.y == b.character.y && a.character.velocity == b.character.velocity &&
+            a.character.angle == b.character.angle && a.old.character_y == b.old.character_y &&
+            a.old.character_angle == b.old.character_angle && a.old.world_x == b.old.world_x &&
+            a.world_x == b.world_x && a.random == b.random;
+
+        for (size_t i = 0; same && i < span_count; ++i)
+        {
+            same = a.spans[i].offset_x == b.spans[i].offset_x && a.spans[i].points == b.spans[i].points;
+            for (size_t j = 0; same && j < NUM_OBSTACLES_IN_SPAN; ++j)
+            {
+                const simulation_state::obstacle& oa = a.spans[i].obstacles[j];
+                const simulation_state::obstacle& ob = b.spans[i].obstacles[j];
+                same = oa.position.x == ob.position.x && oa.position.y == ob.position.y &&
+                    same_rect(oa.collider, ob.collider);
+            }
+        }
+
+        return same;
+    }
+
+    // the live game is drawn twice per tick, which must not touch the rules
+    bool check_rollout(game& g, renderer& r)
+    {
+        const size_t tap_count = sizeof(ROLLOUT_TAPS) / sizeof(ROLLOUT_TAPS[0]);
+        const simulation_state start = g.snapshot();
+        bool same = true;
+
+        size_t tap = 0;
+        for (uint32_t tick = 0; tick < ROLLOUT_TICKS; ++tick)
+        {
+            for (; tap < tap_count && ROLLOUT_TAPS[tap] <= tick; ++tap) { g.handle_tap_down(); }
+            g.integrate(DELTA_TIME);
+
+            for (float interpolation: { 0.0f, 0.5f })
+            {
+                r.begin_frame(interpolation, DELTA_TIME / 2);
+                g.draw(&r);
+                r.end_frame();
+            }
+
+            const size_t ticks = tick + 1;
+            if (ticks % ROLLOUT_CHECK_EVERY == 0)
+            {
+                const simulation_state predicted =
+                    g.rules().rollout(start, ticks, DELTA_TIME, ROLLOUT_TAPS, tap_count);
+
+                if (!same_state(predicted, g.snapshot(), g.rules().settings().span_count))
+                {
+                    std::printf("tick %zu: rollout differs from the live game\n", ticks);
+                    same = false;
+                }
+            }
+        }
+
+        std::printf("%zu-tick rollout %s the live game\n", ROLLOUT_TICKS, same ? "matches" : "differs from");
+        return same;
+    }
+
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2)
+    {
+        std::fprintf(stderr, "usage: frame_check <bundle.txt>\n");
+        return 1;
+    }
+
+    std::ifstream file { argv[1] };
+    if (!file.is_open())
+    {
+        std::fprintf(stderr, "frame_check: can not open %s\n", argv[1]);
+        return 1;
+    }
+
+    const std::string text { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+    bundle b;
+    parse_bundle(text, b);
+
+    game g(0, b);
+    renderer r(nullptr);
+
+    frame_runner runner { g, r, false, 0, 0 };
+    for (size_t i = 0; i < WARM_UP_ROUNDS; ++i) { runner.round(); }
+
+    const size_t warm_up_frames = runner.frame;
+    runner.checked = true;
+    for (size_t i = 0; i < CHECKED_ROUNDS; ++i) { runner.round(); }
+    runner.long_round();
+
+    std::printf("%zu frames checked, %zu allocating calls, %zu clamped vertices, frame arena peak %zu of %zu bytes\n",
+        runner.frame - warm_up_frames, runner.failures, r.clamped_vertices(),
+        r.transient_arena().peak(), r.transient_arena().capacity());
+
+    const bool tick_rates_agree = check_tick_rates(text);
+    const bool rollout_agrees = check_rollout(g, r);
+
+    return runner.failures == 0 && r.clamped_vertices() == 0 && tick_rates_agree && rollout_agrees ? 0 : 1;
+}
@@ -0,0 +1,315 @@
+// Offline sprite mesh generator.
+//
+// Fits a convex outline around the visible texels of every sprite drawn with
+// a blended material and writes it as a sprite-mesh line right after the
+// sprite's own line, so arrays, clips and fonts that copy the sprite later
+// see it. The renderer then draws a triangle fan instead of the full rect.
+// Outlines stay inside the rect and have at most <max-points> points; a
+// sprite whose outline would not save at least a tenth of its rect keeps
+// the rect. Sprites that only fonts list are skipped: text labels draw
+// glyphs as prebuilt quads. Existing sprite-mesh lines are replaced.
+//
+// usage: sprite_mesher <bundle> <output> [max-points]
+
+#include "../code/bmp.h"
+#include "../code/bundle.h"
+#include "../code/rect.h"
+#include "../code/vec2.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+    const float MIN_SAVING = 0.1f;
+
+    struct texture_pixels
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> texels;
+    };
+
+    inline float cross(vec2 a, vec2 b)
+    {
+        return a.x * b.y - a.y * b.x;
+    }
+
+    float polygon_area(const std::vector<vec2>& p)
+    {
+        float area = 0.0f;
+        for (size_t i = 0; i < p.size(); ++i) { area += cross(p[i], p[(i + 1) % p.size()]); }
+        return 0.5f * area;
+    }
+
+    // Andrew's monotone chain, counter-clockwise, without collinear points
+    std::vector<vec2> convex_hull(std::vector<vec2> points)
+    {
+        std::sort(points.begin(), points.end(), [](vec2 a, vec2 b)
+        {
+            return a.x < b.x || (a.x == b.x && a.y < b.y);
+        });
+
+        std::vector<vec2> hull(2 * points.size());
+        size_t k = 0;
+
+        for (size_t i = 0; i < points.size(); ++i)
+        {
+            while (k >= 2 && cross(hull[k - 1] - hull[k - 2], points[i] - hull[k - 2]) <= 0.0f) { --k; }
+            hull[k++] = points[i];
+        }
+
+        for (size_t i = points.size() - 1, lower = k + 1; i-- > 0;)
+        {
+            while (k >= lower && cross(hull[k - 1] - hull[k - 2], points[i] - hull[k - 2]) <= 0.0f) { --k; }
+            hull[k++] = points[i];
+        }
+
+        hull.resize(k - 1);
+        return hull;
+    }
+
+    // Drops edges until max_points are left: an edge goes by extending its
+    // neighbours to where they meet, choosing the edge that adds the least
+    // area and keeping every point inside [0, size]. False when no edge can go.
+    bool reduce(std::vector<vec2>& p, size_t max_points, vec2 size)
+    {
+        while (p.size() > max_points)
+        {
+            const size_t n = p.size();
+            size_t best = n;
+            float best_area = 0.0f;
+            vec2 best_point = {};
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                const vec2 a = p[(i + n - 1) % n], b = p[i], c = p[(i + 1) % n], d = p[(i + 2) % n];
+                const vec2 d1 = b - a;
+                const vec2 d2 = d - c;
+
+                const float denominator = cross(d1, d2);
+                if (denominator <= 1.0e-6f) { continue; }
+
+                const float t = cross(c - b, d2) / denominator;
+                const vec2 q = b + d1 * t;
+                if (t < 0.0f || q.x < -1.0e-4f || q.y < -1.0e-4f || q.x > size.x + 1.0e-4f || q.y > size.y + 1.0e-4f)
+                {
+                    continue;
+                }
+
+                const float area = 0.5f * std::fabs(cross(c - b, q - b));
+                if (best == n || area < best_area)
+                {
+                    best = i;
+                    best_area = area;
+                    best_point = vec2 { std::min(std::max(q.x, 0.0f), size.x), std::min(std::max(q.y, 0.0f), size.y) };
+                }
+            }
+
+            if (best == n) { return false; }
+
+            p[best] = best_point;
+            p.erase(p.begin() + (best + 1) % n);
+        }
+
+        return true;
+    }
+
+    // outline in pixels from the bottom left corner of the sprite's texels
+    bool fit_outline(const texture_pixels& page, const sprite& s, size_t max_points, std::vector<vec2>& outline)
+    {
+        const int32_t x0 = int32_t(std::lround(s.uv.left * page.width));
+        const int32_t x1 = int32_t(std::lround(s.uv.right * page.width));
+        const int32_t y0 = int32_t(std::lround(s.uv.bottom * page.height));
+        const int32_t y1 = int32_t(std::lround(s.uv.top * page.height));
+
+        // flipped or wrapping sprites are left alone
+        if (x0 < 0 || y0 < 0 || x1 <= x0 || y1 <= y0 || uint32_t(x1) > page.width || uint32_t(y1) > page.height)
+        {
+            return false;
+        }
+
+        // the outer corners of the first and last visible texel of every row
+        std::vector<vec2> corners;
+        for (int32_t y = y0; y < y1; ++y)
+        {
+            int32_t left = x1, right = x0 - 1;
+            for (int32_t x = x0; x < x1; ++x)
+            {
+                if (page.texels[4 * (size_t(y) * page.width + x) + 3] == 0) { continue; }
+                left = std::min(left, x);
+                right = std::max(right, x);
+            }
+
+            if (right < left) { continue; }
+
+            const float bottom = float(y - y0), top = float(y + 1 - y0);
+            corners.push_back(vec2 { float(left - x0), bottom });
+            corners.push_back(vec2 { float(left - x0), top });
+            corners.push_back(vec2 { float(right + 1 - x0), bottom });
+            corners.push_back(vec2 { float(right + 1 - x0), top });
+        }
+
+        if (corners.empty()) { return false; }
+
+        const vec2 size { float(x1 - x0), float(y1 - y0) };
+        outline = convex_hull(corners);
+
+        return outline.size() >= 3 && reduce(outline, max_points, size) &&
+            polygon_area(outline) <= (1.0f - MIN_SAVING) * size.x * size.y;
+    }
+
+    // thousandths of a pixel are plenty and keep float noise out of the bundle
+    inline float snap(float v)
+    {
+        return std::round(v * 1000.0f) / 1000.0f + 0.0f;
+    }
+
+    // sprites listed by fonts and by no array or clip
+    std::unordered_set<std::string> glyph_only_sprites(const std::string& text)
+    {
+        std::unordered_set<std::string> glyphs, others;
+        std::istringstream lines { text };
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            std::istringstream s { line };
+            std::string type, id, word;
+            s >> type >> id;
+
+            if (type == "font")
+            {
+                // spacing and character codes come before the glyphs
+                s >> word >> word;
+                while (s >> word) { glyphs.insert(word); }
+            }
+            else if (type == "sprite-array" || type == "clip")
+            {
+                // a clip's frame rate comes first, it is no sprite name
+                while (s >> word) { others.insert(word); }
+            }
+        }
+
+        for (auto& name: others) { glyphs.erase(name); }
+        return glyphs;
+    }
+
+    std::string read_text(const std::string& path)
+    {
+        std::ifstream s { path, std::ios::binary };
+        if (!s.is_open()) { throw std::runtime_error("can not open " + path); }
+        return std::string { std::istreambuf_iterator<char>(s), std::istreambuf_iterator<char>() };
+    }
+
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3 && argc != 4)
+    {
+        std::cerr << "usage: sprite_mesher <bundle> <output> [max-points]" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        const std::string bundle_path = argv[1];
+        const size_t max_points = argc == 4 ? std::strtoul(argv[3], nullptr, 10) : MAX_OUTLINE_POINTS;
+        if (max_points < 3 || max_points > MAX_OUTLINE_POINTS)
+        {
+            throw std::runtime_error("max-points is between 3 and " + std::to_string(MAX_OUTLINE_POINTS));
+        }
+
+        const size_t slash = bundle_path.find_last_of('/');
+        const std::string root = slash == std::string::npos ? "" : bundle_path.substr(0, slash + 1);
+
+        const std::string text = read_text(bundle_path);
+        bundle b;
+        parse_bundle(text, b);
+
+        std::vector<texture_pixels> pages(b.textures().size());
+        for (size_t i = 0; i < pages.size(); ++i)
+        {
+            const std::string data = read_text(root + b.textures()[i].path);
+            decode_bmp(std::vector<uint8_t>(data.begin(), data.end()), pages[i].width, pages[i].height, pages[i].texels);
+        }
+
+        std::ostringstream out;
+        out.precision(6);
+
+        size_t meshes = 0;
+        double rect_fill = 0.0, mesh_fill = 0.0;
+
+        const std::unordered_set<std::string> glyphs = glyph_only_sprites(text);
+
+        // written back with the bundle's line endings
+        const std::string eol = text.find("\r\n") != std::string::npos ? "\r\n" : "\n";
+
+        std::istringstream lines { text };
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+
+            std::istringstream s { line };
+            std::string type, id;
+            s >> type >> id;
+
+            if (type == "sprite-mesh") { continue; }
+            out << line << eol;
+
+            if ((type != "sprite" && type != "sprite-uv") || glyphs.count(id) != 0) { continue; }
+
+            const sprite sp = b.sprite(id);
+            const material_source& material = b.materials()[sp.material];
+            if (material.blend == blend_mode::none) { continue; }
+
+            const vec2 rect = rect_size(sp.rect);
+            rect_fill += rect.x * rect.y;
+
+            std::vector<vec2> outline;
+            if (!fit_outline(pages[material.texture], sp, max_points, outline))
+            {
+                mesh_fill += rect.x * rect.y;
+                continue;
+            }
+
+            // texels to rect units, which differ for scaled sprite-uv entries
+            const texture_pixels& page = pages[material.texture];
+            const vec2 scale {
+                rect.x / ((sp.uv.right - sp.uv.left) * page.width),
+                rect.y / ((sp.uv.top - sp.uv.bottom) * page.height)
+            };
+
+            out << "sprite-mesh " << id;
+            for (auto& p: outline) { out << " " << snap(p.x * scale.x) << " " << snap(p.y * scale.y); }
+            out << eol;
+
+            mesh_fill += polygon_area(outline) * scale.x * scale.y;
+            ++meshes;
+        }
+
+        std::ofstream file { argv[2], std::ios::binary };
+        if (!file.is_open()) { throw std::runtime_error(std::string("can not write ") + argv[2]); }
+        file << out.str();
+
+        std::cout << meshes << " sprite meshes, blended sprites cover "
+            << int(std::lround(100.0 * mesh_fill / std::max(rect_fill, 1.0))) << "% of their rects" << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "sprite_mesher: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}